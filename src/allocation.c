@@ -0,0 +1,83 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <gst/video/video.h>
+#include <gst/video/gstvideopool.h>
+
+#include "allocation.h"
+
+/* Alignment in bytes of the start of each buffer. This is enough for
+ * the SIMD copies in the decoders and the GL driver. The strides
+ * aren't aligned because the sink's upload paths take the layout from
+ * the caps and ignore any GstVideoMeta, so padded rows would be
+ * uploaded sheared */
+#define ALIGNMENT 32
+
+/* The sink keeps the last frame and renders another one */
+#define MIN_BUFFERS 2
+
+bool
+allocation_propose_pool (GstQuery *query)
+{
+  GstCaps *caps;
+  gboolean need_pool;
+  GstVideoInfo info;
+  GstAllocationParams params;
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    return false;
+
+  gst_allocation_params_init (&params);
+  params.align = ALIGNMENT - 1;
+  gst_query_add_allocation_param (query, NULL, &params);
+
+  if (!need_pool)
+    return true;
+
+  pool = gst_video_buffer_pool_new ();
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config,
+                                     caps,
+                                     GST_VIDEO_INFO_SIZE (&info),
+                                     MIN_BUFFERS,
+                                     0 /* max_buffers */);
+  gst_buffer_pool_config_set_allocator (config, NULL, &params);
+
+  if (gst_buffer_pool_set_config (pool, config))
+    gst_query_add_allocation_pool (query,
+                                   pool,
+                                   GST_VIDEO_INFO_SIZE (&info),
+                                   MIN_BUFFERS,
+                                   0 /* max_buffers */);
+
+  gst_object_unref (pool);
+
+  return true;
+}
@@ -0,0 +1,38 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _ALLOCATION_H
+#define _ALLOCATION_H
+
+#include <stdbool.h>
+#include <gst/gst.h>
+
+/* Answers an allocation query from upstream on behalf of the video
+ * sink. The pool that is proposed has aligned buffers with the
+ * default layout for the caps so that a decoder can write its frames
+ * directly into buffers that can be uploaded without copying them
+ * again. Returns false if the caps in the query aren't raw video */
+bool
+allocation_propose_pool (GstQuery *query);
+
+#endif /* _ALLOCATION_H */
@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# Runs every effect in sprite-player against generated test videos
+# and prints the results as a JSON array.
+#
+# Usage: bench.sh PATH-TO-SPRITE-PLAYER
+#
+# BENCH_FRAMES sets the number of frames for each run,
+# BENCH_SIZES the list of video sizes and BENCH_ONSCREEN=1 adds runs
+# that render to a window which needs a display. BENCH_ASYNC_UPLOAD=1
+# repeats each headless run with the uploads on a separate thread.
+
+set -e
+
+player="$1"
+
+if test -z "$player"; then
+    echo "usage: $0 PATH-TO-SPRITE-PLAYER" >&2
+    exit 1
+fi
+
+frames="${BENCH_FRAMES:-300}"
+sizes="${BENCH_SIZES:-854x480 1920x1080 3840x2160}"
+
+# The output is captured before it is piped anywhere so that set -e
+# sees the player's exit status
+effect_list=`"$player" --list-effects`
+n_effects=`echo "$effect_list" | wc -l`
+
+first=yes
+
+run () {
+    if test "$first" = yes; then
+        first=no
+        echo "["
+    else
+        echo ","
+    fi
+
+    echo "bench: $*" >&2
+
+    result=`"$player" --json --frames="$frames" "$@"`
+    echo "$result" | tr -d '\n'
+}
+
+for size in $sizes; do
+    run --headless --decode-only --test-source="$size"
+
+    effect=0
+    while test "$effect" -lt "$n_effects"; do
+        run --headless --uncapped --size="$size" \
+            --test-source="$size" --effect="$effect"
+
+        if test "$BENCH_ASYNC_UPLOAD" = 1; then
+            run --headless --uncapped --async-upload --size="$size" \
+                --test-source="$size" --effect="$effect"
+        fi
+
+        if test "$BENCH_ONSCREEN" = 1; then
+            run --uncapped --test-source="$size" --effect="$effect"
+            run --test-source="$size" --effect="$effect"
+        fi
+
+        effect=`expr "$effect" + 1`
+    done
+done
+
+if test "$first" = yes; then
+    echo "["
+fi
+
+echo
+echo "]"
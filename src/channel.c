@@ -0,0 +1,172 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include "channel.h"
+
+/* Must be a power of two */
+#define CHANNEL_SIZE 64
+
+typedef struct
+{
+  GSource source;
+  Channel *channel;
+} ChannelSource;
+
+struct _Channel
+{
+  GMainContext *context;
+  GSource *source;
+
+  ChannelFunc func;
+  void *user_data;
+
+  ChannelMessage messages[CHANNEL_SIZE];
+
+  /* These only ever increase. head is only written by the sender and
+   * tail only by the receiver */
+  int head;
+  int tail;
+};
+
+static bool
+is_empty (Channel *channel)
+{
+  return g_atomic_int_get (&channel->head) == channel->tail;
+}
+
+static gboolean
+channel_source_prepare (GSource *source,
+                        int *timeout)
+{
+  *timeout = -1;
+
+  return !is_empty (((ChannelSource *) source)->channel);
+}
+
+static gboolean
+channel_source_check (GSource *source)
+{
+  return !is_empty (((ChannelSource *) source)->channel);
+}
+
+static gboolean
+channel_source_dispatch (GSource *source,
+                         GSourceFunc callback,
+                         void *user_data)
+{
+  Channel *channel = ((ChannelSource *) source)->channel;
+  int head = g_atomic_int_get (&channel->head);
+
+  /* Only the messages that were there at the start are handled so
+   * that a busy sender can't starve the rest of the main loop */
+  while (channel->tail != head)
+    {
+      ChannelMessage message =
+        channel->messages[channel->tail & (CHANNEL_SIZE - 1)];
+
+      /* Free the slot before calling the function in case it sends a
+       * message back that causes another one to arrive */
+      g_atomic_int_set (&channel->tail, channel->tail + 1);
+
+      channel->func (&message, channel->user_data);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs
+channel_source_funcs =
+  {
+    channel_source_prepare,
+    channel_source_check,
+    channel_source_dispatch,
+    NULL /* finalize */
+  };
+
+Channel *
+channel_new (GMainContext *receiver_context,
+             ChannelFunc func,
+             void *user_data)
+{
+  Channel *channel = g_slice_new0 (Channel);
+
+  channel->func = func;
+  channel->user_data = user_data;
+
+  if (receiver_context == NULL)
+    receiver_context = g_main_context_default ();
+  channel->context = g_main_context_ref (receiver_context);
+
+  channel->source = g_source_new (&channel_source_funcs,
+                                  sizeof (ChannelSource));
+  ((ChannelSource *) channel->source)->channel = channel;
+  g_source_attach (channel->source, channel->context);
+
+  return channel;
+}
+
+bool
+channel_send_tagged (Channel *channel,
+                     int type,
+                     int tag,
+                     int64_t value)
+{
+  int tail = g_atomic_int_get (&channel->tail);
+  ChannelMessage *message;
+
+  if (channel->head - tail >= CHANNEL_SIZE)
+    return false;
+
+  message = channel->messages + (channel->head & (CHANNEL_SIZE - 1));
+  message->type = type;
+  message->tag = tag;
+  message->value = value;
+
+  /* The atomic store is a full barrier so the receiver will see the
+   * message before it sees the new head */
+  g_atomic_int_set (&channel->head, channel->head + 1);
+
+  g_main_context_wakeup (channel->context);
+
+  return true;
+}
+
+bool
+channel_send (Channel *channel,
+              int type,
+              int64_t value)
+{
+  return channel_send_tagged (channel, type, 0 /* tag */, value);
+}
+
+void
+channel_free (Channel *channel)
+{
+  g_source_destroy (channel->source);
+  g_source_unref (channel->source);
+  g_main_context_unref (channel->context);
+
+  g_slice_free (Channel, channel);
+}
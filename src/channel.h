@@ -0,0 +1,71 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _CHANNEL_H
+#define _CHANNEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <glib.h>
+
+/* A lock-free queue of small messages from one thread to another. It
+ * can have a single sending thread and the messages are received by a
+ * GSource attached to the receiving thread's main context. Sending
+ * never blocks so it is safe to use from the render thread */
+
+typedef struct
+{
+  int type;
+  /* Can be used to match a reply to the message that caused it. This
+   * is 0 for messages sent with channel_send() */
+  int tag;
+  int64_t value;
+} ChannelMessage;
+
+typedef void
+(* ChannelFunc) (const ChannelMessage *message,
+                 void *user_data);
+
+typedef struct _Channel Channel;
+
+Channel *
+channel_new (GMainContext *receiver_context,
+             ChannelFunc func,
+             void *user_data);
+
+/* Returns false if the channel is full */
+bool
+channel_send (Channel *channel,
+              int type,
+              int64_t value);
+
+bool
+channel_send_tagged (Channel *channel,
+                     int type,
+                     int tag,
+                     int64_t value);
+
+void
+channel_free (Channel *channel);
+
+#endif /* _CHANNEL_H */
@@ -0,0 +1,488 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+
+#include "contact-sheet.h"
+#include "effects.h"
+
+typedef struct
+{
+  GThread *thread;
+
+  const char *uri;
+  int cell_width;
+  int cell_height;
+
+  /* The range of cells that this worker decodes */
+  int first_cell;
+  int n_cells;
+  int total_cells;
+
+  /* Shared between the workers. Each one only writes to its own
+   * range */
+  GstSample **samples;
+
+  bool failed;
+} Worker;
+
+/* State for painting the decoded frames with the effect */
+typedef struct
+{
+  const Effect *effect;
+  void *effect_data;
+  CoglGstVideoSink *sink;
+  bool frame_ready;
+  bool failed;
+} Painter;
+
+static void *
+worker_thread_func (void *user_data)
+{
+  Worker *worker = user_data;
+  GstElement *pipeline, *src, *sink;
+  GstCaps *caps;
+  GError *error = NULL;
+  gint64 duration;
+  int i;
+
+  /* The frames are scaled by the workers so that the scaling is
+   * spread over the cores too */
+  pipeline = gst_parse_launch ("uridecodebin name=src ! "
+                               "videoconvert ! "
+                               "videoscale ! "
+                               "appsink name=sink sync=false",
+                               &error);
+
+  /* A missing plugin is reported as an error even if a partial
+   * pipeline is returned */
+  if (error)
+    {
+      g_warning ("Failed to create the contact sheet pipeline: %s",
+                 error->message);
+      g_error_free (error);
+
+      if (pipeline)
+        gst_object_unref (pipeline);
+
+      worker->failed = true;
+      return NULL;
+    }
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "uri", worker->uri, NULL);
+  gst_object_unref (src);
+
+  caps = gst_caps_new_simple ("video/x-raw",
+                              "format", G_TYPE_STRING, "RGBA",
+                              "width", G_TYPE_INT, worker->cell_width,
+                              "height", G_TYPE_INT, worker->cell_height,
+                              "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+                              NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  gst_app_sink_set_caps (GST_APP_SINK (sink), caps);
+  gst_caps_unref (caps);
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+
+  if (gst_element_get_state (pipeline,
+                             NULL, NULL, /* state, pending */
+                             GST_CLOCK_TIME_NONE) ==
+      GST_STATE_CHANGE_FAILURE ||
+      !gst_element_query_duration (pipeline, GST_FORMAT_TIME, &duration))
+    {
+      worker->failed = true;
+      goto done;
+    }
+
+  for (i = worker->first_cell;
+       i < worker->first_cell + worker->n_cells;
+       i++)
+    {
+      /* Take the frame from the middle of each cell's share of the
+       * video */
+      GstClockTime time =
+        gst_util_uint64_scale (duration, i * 2 + 1, worker->total_cells * 2);
+
+      if (gst_element_seek_simple (pipeline,
+                                   GST_FORMAT_TIME,
+                                   GST_SEEK_FLAG_FLUSH |
+                                   GST_SEEK_FLAG_ACCURATE,
+                                   time))
+        worker->samples[i] = gst_app_sink_pull_preroll (GST_APP_SINK (sink));
+    }
+
+ done:
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  return NULL;
+}
+
+static bool
+decode_frames (const char *uri,
+               int n_cells,
+               int cell_width,
+               int cell_height,
+               GstSample **samples)
+{
+  int n_workers = MIN (g_get_num_processors (), n_cells);
+  Worker *workers = g_new0 (Worker, n_workers);
+  bool ret = true;
+  int i;
+
+  for (i = 0; i < n_workers; i++)
+    {
+      Worker *worker = workers + i;
+
+      worker->uri = uri;
+      worker->cell_width = cell_width;
+      worker->cell_height = cell_height;
+      worker->first_cell = i * n_cells / n_workers;
+      worker->n_cells = (i + 1) * n_cells / n_workers - worker->first_cell;
+      worker->total_cells = n_cells;
+      worker->samples = samples;
+      worker->thread = g_thread_new ("contact-sheet",
+                                     worker_thread_func,
+                                     worker);
+    }
+
+  for (i = 0; i < n_workers; i++)
+    {
+      g_thread_join (workers[i].thread);
+
+      if (workers[i].failed)
+        ret = false;
+    }
+
+  g_free (workers);
+
+  return ret;
+}
+
+static CoglOffscreen *
+create_offscreen (CoglContext *context,
+                  int width,
+                  int height)
+{
+  CoglTexture2D *texture;
+  CoglOffscreen *offscreen;
+
+  texture = cogl_texture_2d_new_with_size (context,
+                                           width, height,
+                                           COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                           NULL /* error */);
+  if (texture == NULL)
+    return NULL;
+
+  offscreen = cogl_offscreen_new_with_texture (COGL_TEXTURE (texture));
+  cogl_object_unref (texture);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), NULL))
+    {
+      cogl_object_unref (offscreen);
+      return NULL;
+    }
+
+  cogl_framebuffer_orthographic (COGL_FRAMEBUFFER (offscreen),
+                                 0, 0, width, height,
+                                 -1, 100);
+
+  return offscreen;
+}
+
+static void
+pipeline_ready_cb (CoglGstVideoSink *sink,
+                   Painter *painter)
+{
+  painter->effect->set_up_pipeline (sink, painter->effect_data);
+}
+
+static void
+new_frame_cb (CoglGstVideoSink *sink,
+              Painter *painter)
+{
+  painter->frame_ready = true;
+}
+
+static gboolean
+bus_watch (GstBus *bus,
+           GstMessage *msg,
+           void *user_data)
+{
+  Painter *painter = user_data;
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    painter->failed = true;
+
+  return TRUE;
+}
+
+/* Paints one frame with the effect into its own framebuffer so that
+ * the effect can't draw over the neighbouring cells */
+static CoglOffscreen *
+paint_cell (CoglContext *context,
+            Painter *painter,
+            GstAppSrc *src,
+            GstSample *sample,
+            int width,
+            int height)
+{
+  CoglGstRectangle available, video_output;
+  CoglOffscreen *cell;
+
+  painter->frame_ready = false;
+  gst_app_src_push_buffer (src,
+                           gst_buffer_ref (gst_sample_get_buffer (sample)));
+
+  while (!painter->frame_ready && !painter->failed)
+    g_main_context_iteration (NULL, TRUE);
+
+  if (painter->failed)
+    return NULL;
+
+  cell = create_offscreen (context, width, height);
+
+  if (cell == NULL)
+    return NULL;
+
+  available.x = 0;
+  available.y = 0;
+  available.width = width;
+  available.height = height;
+  cogl_gst_video_sink_fit_size (painter->sink, &available, &video_output);
+
+  cogl_framebuffer_clear4f (COGL_FRAMEBUFFER (cell),
+                            COGL_BUFFER_BIT_COLOR,
+                            0.0f, 0.0f, 0.0f, 1.0f);
+  painter->effect->paint (COGL_FRAMEBUFFER (cell),
+                          &video_output,
+                          painter->effect_data);
+
+  return cell;
+}
+
+static bool
+save_framebuffer (CoglFramebuffer *fb,
+                  const char *filename,
+                  GError **error)
+{
+  int width = cogl_framebuffer_get_width (fb);
+  int height = cogl_framebuffer_get_height (fb);
+  uint8_t *pixels = g_malloc (width * height * 3);
+  GdkPixbuf *pixbuf;
+  bool ret;
+
+  cogl_framebuffer_read_pixels (fb,
+                                0, 0, /* x, y */
+                                width, height,
+                                COGL_PIXEL_FORMAT_RGB_888,
+                                pixels);
+
+  pixbuf = gdk_pixbuf_new_from_data (pixels,
+                                     GDK_COLORSPACE_RGB,
+                                     FALSE, /* has_alpha */
+                                     8, /* bits_per_sample */
+                                     width, height,
+                                     width * 3, /* rowstride */
+                                     NULL, /* destroy_fn */
+                                     NULL /* destroy_fn_data */);
+
+  ret = gdk_pixbuf_save (pixbuf, filename, "png", error, NULL);
+
+  g_object_unref (pixbuf);
+  g_free (pixels);
+
+  return ret;
+}
+
+static bool
+paint_sheet (CoglContext *context,
+             const Effect *effect,
+             int columns,
+             int rows,
+             int width,
+             int height,
+             GstSample **samples,
+             const char *filename,
+             GError **error)
+{
+  int cell_width = width / columns, cell_height = height / rows;
+  CoglOffscreen *sheet, *cell;
+  CoglPipeline *cell_pipeline;
+  GstElement *pipeline, *src;
+  GstCaps *caps = NULL;
+  Painter painter;
+  GstBus *bus;
+  guint bus_watch_id;
+  bool ret = false;
+  int i;
+
+  sheet = create_offscreen (context, width, height);
+
+  if (sheet == NULL)
+    {
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   G_FILE_ERROR_NOMEM,
+                   "Failed to create a %ix%i framebuffer",
+                   width, height);
+      return false;
+    }
+
+  cogl_framebuffer_clear4f (COGL_FRAMEBUFFER (sheet),
+                            COGL_BUFFER_BIT_COLOR,
+                            0.0f, 0.0f, 0.0f, 1.0f);
+
+  /* The frames go through a sink of their own so that the effects
+   * can use them in the same way as when playing */
+  painter.effect = effect;
+  painter.sink = cogl_gst_video_sink_new (context);
+  effect_set_up_sink (effect, painter.sink);
+  painter.effect_data = effect->init (context, painter.sink);
+  painter.failed = false;
+
+  g_signal_connect (painter.sink, "pipeline-ready",
+                    G_CALLBACK (pipeline_ready_cb), &painter);
+  g_signal_connect (painter.sink, "new-frame",
+                    G_CALLBACK (new_frame_cb), &painter);
+  g_object_set (painter.sink, "sync", FALSE, NULL);
+
+  for (i = 0; i < columns * rows && caps == NULL; i++)
+    if (samples[i])
+      caps = gst_sample_get_caps (samples[i]);
+
+  src = gst_element_factory_make ("appsrc", NULL);
+  gst_app_src_set_caps (GST_APP_SRC (src), caps);
+  g_object_set (src, "format", GST_FORMAT_TIME, NULL);
+
+  pipeline = gst_pipeline_new ("contact-sheet");
+  gst_bin_add_many (GST_BIN (pipeline), src, GST_ELEMENT (painter.sink), NULL);
+  gst_element_link (src, GST_ELEMENT (painter.sink));
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  bus_watch_id = gst_bus_add_watch (bus, bus_watch, &painter);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  cell_pipeline = cogl_pipeline_new (context);
+
+  for (i = 0; i < columns * rows; i++)
+    {
+      int x = i % columns * cell_width, y = i / columns * cell_height;
+
+      /* Cells whose frame couldn't be decoded are left black */
+      if (samples[i] == NULL)
+        continue;
+
+      cell = paint_cell (context,
+                         &painter,
+                         GST_APP_SRC (src),
+                         samples[i],
+                         cell_width,
+                         cell_height);
+
+      if (cell == NULL)
+        break;
+
+      cogl_pipeline_set_layer_texture (cell_pipeline,
+                                       0,
+                                       cogl_offscreen_get_texture (cell));
+      cogl_framebuffer_draw_rectangle (COGL_FRAMEBUFFER (sheet),
+                                       cell_pipeline,
+                                       x, y,
+                                       x + cell_width, y + cell_height);
+      cogl_object_unref (cell);
+    }
+
+  if (i < columns * rows)
+    g_set_error (error,
+                 G_FILE_ERROR,
+                 G_FILE_ERROR_FAILED,
+                 "Failed to paint the contact sheet");
+  else
+    ret = save_framebuffer (COGL_FRAMEBUFFER (sheet), filename, error);
+
+  cogl_object_unref (cell_pipeline);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_source_remove (bus_watch_id);
+  gst_object_unref (pipeline);
+
+  effect->fini (painter.effect_data);
+  cogl_object_unref (sheet);
+
+  return ret;
+}
+
+bool
+contact_sheet_generate (CoglContext *context,
+                        const char *uri,
+                        const Effect *effect,
+                        int columns,
+                        int rows,
+                        int width,
+                        int height,
+                        const char *filename,
+                        GError **error)
+{
+  int n_cells = columns * rows;
+  GstSample **samples = g_new0 (GstSample *, n_cells);
+  bool ret;
+  int i;
+
+  if (!decode_frames (uri, n_cells, width / columns, height / rows, samples))
+    {
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   G_FILE_ERROR_FAILED,
+                   "Failed to decode '%s'",
+                   uri);
+      ret = false;
+    }
+  else
+    {
+      ret = paint_sheet (context,
+                         effect,
+                         columns, rows,
+                         width, height,
+                         samples,
+                         filename,
+                         error);
+    }
+
+  for (i = 0; i < n_cells; i++)
+    if (samples[i])
+      gst_sample_unref (samples[i]);
+
+  g_free (samples);
+
+  return ret;
+}
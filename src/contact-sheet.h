@@ -0,0 +1,50 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _CONTACT_SHEET_H
+#define _CONTACT_SHEET_H
+
+#include <stdbool.h>
+#include <glib.h>
+#include <cogl/cogl.h>
+
+#include "effect.h"
+
+/* Makes a PNG with a grid of frames taken at evenly spaced times
+ * through a video. The times are split into ranges that are each
+ * decoded by a separate pipeline on its own thread. The frames are
+ * then painted with the effect into one offscreen framebuffer. This
+ * must be called from the thread that owns the default main
+ * context */
+bool
+contact_sheet_generate (CoglContext *context,
+                        const char *uri,
+                        const Effect *effect,
+                        int columns,
+                        int rows,
+                        int width,
+                        int height,
+                        const char *filename,
+                        GError **error);
+
+#endif /* _CONTACT_SHEET_H */
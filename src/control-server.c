@@ -0,0 +1,210 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gio/gio.h>
+
+#include "control-server.h"
+#include "unix-service.h"
+
+struct _ControlServer
+{
+  UnixService *service;
+
+  ControlCommandFunc command_func;
+  void *user_data;
+};
+
+/* There is one of these for each connection. It is reused for each
+ * command because only one can be in progress at a time */
+struct _ControlRequest
+{
+  ControlServer *server;
+  GSocketConnection *connection;
+  GDataInputStream *input;
+};
+
+static void
+read_next_command (ControlRequest *request);
+
+static void
+free_request (ControlRequest *request)
+{
+  g_object_unref (request->input);
+  g_io_stream_close (G_IO_STREAM (request->connection), NULL, NULL);
+  g_object_unref (request->connection);
+
+  g_slice_free (ControlRequest, request);
+}
+
+static void
+read_line_cb (GObject *source_object,
+              GAsyncResult *result,
+              void *user_data)
+{
+  ControlRequest *request = user_data;
+  GError *error = NULL;
+  char *line, *command, *args;
+
+  line = g_data_input_stream_read_line_finish (request->input,
+                                               result,
+                                               NULL, /* length */
+                                               &error);
+
+  if (line == NULL)
+    {
+      /* NULL without an error means the client hung up */
+      if (error)
+        {
+          g_warning ("Error reading control command: %s", error->message);
+          g_clear_error (&error);
+        }
+
+      free_request (request);
+      return;
+    }
+
+  command = g_strstrip (line);
+
+  if (*command == '\0')
+    {
+      g_free (line);
+      read_next_command (request);
+      return;
+    }
+
+  args = command + strcspn (command, " \t");
+
+  if (*args)
+    {
+      *(args++) = '\0';
+      g_strchug (args);
+    }
+
+  request->server->command_func (request,
+                                 command,
+                                 args,
+                                 request->server->user_data);
+
+  g_free (line);
+}
+
+static void
+read_next_command (ControlRequest *request)
+{
+  g_data_input_stream_read_line_async (request->input,
+                                       G_PRIORITY_DEFAULT,
+                                       NULL, /* cancellable */
+                                       read_line_cb,
+                                       request);
+}
+
+void
+control_request_reply (ControlRequest *request,
+                       const char *format,
+                       ...)
+{
+  GOutputStream *stream;
+  GString *reply = g_string_new (NULL);
+  GError *error = NULL;
+  va_list ap;
+
+  va_start (ap, format);
+  g_string_append_vprintf (reply, format, ap);
+  va_end (ap);
+
+  g_string_append_c (reply, '\n');
+
+  /* The replies are small so they are just written synchronously */
+  stream = g_io_stream_get_output_stream (G_IO_STREAM (request->connection));
+
+  if (g_output_stream_write_all (stream,
+                                 reply->str,
+                                 reply->len,
+                                 NULL, /* bytes_written */
+                                 NULL, /* cancellable */
+                                 &error))
+    {
+      read_next_command (request);
+    }
+  else
+    {
+      g_warning ("Error writing control reply: %s", error->message);
+      g_clear_error (&error);
+      free_request (request);
+    }
+
+  g_string_free (reply, TRUE);
+}
+
+static gboolean
+incoming_cb (GSocketService *service,
+             GSocketConnection *connection,
+             GObject *source_object,
+             void *user_data)
+{
+  ControlRequest *request = g_slice_new (ControlRequest);
+  GInputStream *stream =
+    g_io_stream_get_input_stream (G_IO_STREAM (connection));
+
+  request->server = user_data;
+  request->connection = g_object_ref (connection);
+  request->input = g_data_input_stream_new (stream);
+  g_data_input_stream_set_newline_type (request->input,
+                                        G_DATA_STREAM_NEWLINE_TYPE_ANY);
+
+  read_next_command (request);
+
+  return TRUE;
+}
+
+ControlServer *
+control_server_new (const char *path,
+                    ControlCommandFunc command_func,
+                    void *user_data,
+                    GError **error)
+{
+  ControlServer *server = g_slice_new (ControlServer);
+
+  server->command_func = command_func;
+  server->user_data = user_data;
+  server->service = unix_service_new (path, incoming_cb, server, error);
+
+  if (server->service == NULL)
+    {
+      g_slice_free (ControlServer, server);
+      return NULL;
+    }
+
+  return server;
+}
+
+void
+control_server_free (ControlServer *server)
+{
+  unix_service_free (server->service);
+
+  g_slice_free (ControlServer, server);
+}
@@ -0,0 +1,64 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _CONTROL_SERVER_H
+#define _CONTROL_SERVER_H
+
+#include <glib.h>
+
+/* Accepts commands on a UNIX domain socket. Each line sent by a
+ * client is a command name optionally followed by a space and its
+ * arguments. The client gets exactly one line back for each command
+ * and the next command isn't read until the reply has been sent, so
+ * a reply can be delayed until the command has taken effect. The
+ * connections are handled from the thread-default main context of
+ * the thread that created the server */
+
+typedef struct _ControlServer ControlServer;
+typedef struct _ControlRequest ControlRequest;
+
+/* The request must be finished with control_request_reply(), either
+ * before returning or later from the same thread */
+typedef void
+(* ControlCommandFunc) (ControlRequest *request,
+                        const char *command,
+                        const char *args,
+                        void *user_data);
+
+ControlServer *
+control_server_new (const char *path,
+                    ControlCommandFunc command_func,
+                    void *user_data,
+                    GError **error);
+
+void
+control_server_free (ControlServer *server);
+
+/* Sends a line back to the client. The request can't be used
+ * afterwards */
+void
+control_request_reply (ControlRequest *request,
+                       const char *format,
+                       ...) G_GNUC_PRINTF (2, 3);
+
+#endif /* _CONTROL_SERVER_H */
@@ -0,0 +1,200 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <gst/video/video.h>
+
+#include "duplicate-detector.h"
+
+/* The data is hashed in several independent lanes so that the
+ * compiler can vectorise the loop */
+#define N_LANES 4
+
+/* Constants from xxHash */
+#define PRIME1 G_GUINT64_CONSTANT (0x9e3779b185ebca87)
+#define PRIME2 G_GUINT64_CONSTANT (0xc2b2ae3d27d4eb4f)
+
+struct _DuplicateDetector
+{
+  GstVideoInfo info;
+  bool have_info;
+
+  bool have_hash;
+  uint64_t last_hash;
+
+  /* Set when the next frame shouldn't be compared. This can be set
+   * from the thread that flushes the pipeline */
+  int reset;
+};
+
+static inline uint64_t
+rotate_left (uint64_t value,
+             int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+static void
+hash_data (uint64_t *lanes,
+           const uint8_t *data,
+           size_t length)
+{
+  uint64_t words[N_LANES];
+  int i;
+
+  for (; length >= sizeof (words); length -= sizeof (words))
+    {
+      memcpy (words, data, sizeof (words));
+
+      for (i = 0; i < N_LANES; i++)
+        lanes[i] = rotate_left (lanes[i] + words[i] * PRIME2, 31) * PRIME1;
+
+      data += sizeof (words);
+    }
+
+  if (length > 0)
+    {
+      memset (words, 0, sizeof (words));
+      memcpy (words, data, length);
+
+      for (i = 0; i < N_LANES; i++)
+        lanes[i] = rotate_left (lanes[i] + words[i] * PRIME2, 31) * PRIME1;
+    }
+}
+
+/* Gets the size of the visible part of a plane. The length of the
+ * rows doesn't include the padding at the end of the stride which
+ * the decoder may leave uninitialised */
+static void
+get_plane_size (GstVideoFrame *frame,
+                int plane,
+                int *row_length_out,
+                int *height_out)
+{
+  int comp, row_length;
+
+  *row_length_out = 0;
+  *height_out = 0;
+
+  for (comp = 0; comp < GST_VIDEO_FRAME_N_COMPONENTS (frame); comp++)
+    {
+      if (GST_VIDEO_FRAME_COMP_PLANE (frame, comp) != plane)
+        continue;
+
+      row_length = (GST_VIDEO_FRAME_COMP_WIDTH (frame, comp) *
+                    GST_VIDEO_FRAME_COMP_PSTRIDE (frame, comp));
+      *row_length_out = MAX (*row_length_out, row_length);
+      *height_out = MAX (*height_out,
+                         GST_VIDEO_FRAME_COMP_HEIGHT (frame, comp));
+    }
+}
+
+static uint64_t
+hash_frame (GstVideoFrame *frame)
+{
+  uint64_t lanes[N_LANES] = { PRIME1, PRIME2, 0, -PRIME1 };
+  const uint8_t *data;
+  int plane, y, height, row_length, stride;
+
+  for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (frame); plane++)
+    {
+      data = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+      stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+      get_plane_size (frame, plane, &row_length, &height);
+
+      for (y = 0; y < height; y++)
+        hash_data (lanes, data + y * stride, row_length);
+    }
+
+  return (rotate_left (lanes[0], 1) + rotate_left (lanes[1], 7) +
+          rotate_left (lanes[2], 12) + rotate_left (lanes[3], 18));
+}
+
+DuplicateDetector *
+duplicate_detector_new (void)
+{
+  return g_slice_new0 (DuplicateDetector);
+}
+
+void
+duplicate_detector_handle_event (DuplicateDetector *detector,
+                                 GstEvent *event)
+{
+  switch (GST_EVENT_TYPE (event))
+    {
+    case GST_EVENT_CAPS:
+      {
+        GstCaps *caps;
+
+        gst_event_parse_caps (event, &caps);
+        detector->have_info = gst_video_info_from_caps (&detector->info,
+                                                        caps);
+        g_atomic_int_set (&detector->reset, TRUE);
+        break;
+      }
+
+    case GST_EVENT_FLUSH_STOP:
+      /* The frame after a seek is always painted */
+      g_atomic_int_set (&detector->reset, TRUE);
+      break;
+
+    default:
+      break;
+    }
+}
+
+bool
+duplicate_detector_check (DuplicateDetector *detector,
+                          GstBuffer *buffer)
+{
+  GstVideoFrame frame;
+  uint64_t hash;
+  bool ret;
+
+  if (!detector->have_info ||
+      !gst_video_frame_map (&frame, &detector->info, buffer, GST_MAP_READ))
+    return false;
+
+  hash = hash_frame (&frame);
+
+  gst_video_frame_unmap (&frame);
+
+  if (g_atomic_int_compare_and_exchange (&detector->reset, TRUE, FALSE))
+    detector->have_hash = false;
+
+  ret = detector->have_hash && hash == detector->last_hash;
+
+  detector->last_hash = hash;
+  detector->have_hash = true;
+
+  return ret;
+}
+
+void
+duplicate_detector_free (DuplicateDetector *detector)
+{
+  g_slice_free (DuplicateDetector, detector);
+}
@@ -0,0 +1,55 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _DUPLICATE_DETECTOR_H
+#define _DUPLICATE_DETECTOR_H
+
+#include <stdbool.h>
+#include <gst/gst.h>
+
+/* Spots frames that are identical to the previous one by hashing the
+ * visible part of every row of every plane. This is meant to be used
+ * from the streaming thread so that the duplicates can be dropped
+ * before they are uploaded */
+
+typedef struct _DuplicateDetector DuplicateDetector;
+
+DuplicateDetector *
+duplicate_detector_new (void);
+
+/* Called for each event on the sink pad. The frame after a caps
+ * change or a flush is never treated as a duplicate */
+void
+duplicate_detector_handle_event (DuplicateDetector *detector,
+                                 GstEvent *event);
+
+/* Returns true if the buffer has the same contents as the last
+ * buffer that was checked */
+bool
+duplicate_detector_check (DuplicateDetector *detector,
+                          GstBuffer *buffer);
+
+void
+duplicate_detector_free (DuplicateDetector *detector);
+
+#endif /* _DUPLICATE_DETECTOR_H */
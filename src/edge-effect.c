@@ -29,6 +29,7 @@
 #include <cogl-gst/cogl-gst.h>
 
 #include "effect.h"
+#include "texture-uploader.h"
 #include "borders.h"
 
 typedef struct _Data
@@ -84,10 +85,8 @@ paint (CoglFramebuffer *fb,
   Data *data = user_data;
   CoglPipeline *pipeline;
 
-  pipeline = cogl_pipeline_copy (data->pipeline);
-  cogl_gst_video_sink_attach_frame (data->sink, pipeline);
-  cogl_object_unref (data->pipeline);
-  data->pipeline = pipeline;
+  pipeline = data->pipeline;
+  texture_uploader_retarget_frame (data->sink, pipeline);
 
   if (data->last_output_width != video_output->width ||
       data->last_output_height != video_output->height)
@@ -178,8 +177,6 @@ init (CoglContext *context,
 
   create_pipeline (data);
 
-  cogl_gst_video_sink_set_default_sample (data->sink, FALSE);
-
   return data;
 }
 
@@ -201,4 +198,5 @@ fini (void *user_data)
   free (data);
 }
 
-EFFECT_DEFINE ("Edge detection", edge_effect)
+EFFECT_DEFINE ("Edge detection", edge_effect,
+               EFFECT_FLAG_CUSTOM_SAMPLE)
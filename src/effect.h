@@ -27,10 +27,25 @@
 #include <cogl/cogl.h>
 #include <cogl-gst/cogl-gst.h>
 
+typedef enum
+{
+  /* The effect changes over time even if the video frame doesn't so
+   * it needs to be repainted for every frame */
+  EFFECT_FLAG_ANIMATED = (1 << 0),
+  /* The effect samples the video in its own snippet so the sink
+   * shouldn't add the default sample */
+  EFFECT_FLAG_CUSTOM_SAMPLE = (1 << 1),
+  /* The effect uses layer 0 for its own texture so the video has to
+   * start at layer 1 */
+  EFFECT_FLAG_RESERVE_LAYER = (1 << 2)
+} EffectFlags;
+
 typedef struct
 {
   const char *name;
 
+  EffectFlags flags;
+
   void *
   (* init) (CoglContext *context,
             CoglGstVideoSink *sink);
@@ -48,14 +63,15 @@ typedef struct
   (* fini) (void *user_data);
 } Effect;
 
-#define EFFECT_DEFINE(name_str, symbol)         \
-  const Effect symbol =                         \
-    {                                           \
-      .name = name_str,                         \
-      .init = init,                             \
-      .set_up_pipeline = set_up_pipeline,       \
-      .paint = paint,                           \
-      .fini = fini                              \
+#define EFFECT_DEFINE(name_str, symbol, effect_flags)  \
+  const Effect symbol =                                \
+    {                                                  \
+      .name = name_str,                                \
+      .flags = effect_flags,                           \
+      .init = init,                                    \
+      .set_up_pipeline = set_up_pipeline,              \
+      .paint = paint,                                  \
+      .fini = fini                                     \
     };
 
 #endif /* _EFFECT_H */
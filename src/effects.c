@@ -46,3 +46,16 @@ effects[N_EFFECTS] =
 _Static_assert (G_N_ELEMENTS (effects) == N_EFFECTS,
                 "If you add an effect, don't forget to update N_EFFECTS "
                 "in effects.h");
+
+void
+effect_set_up_sink (const Effect *effect,
+                    CoglGstVideoSink *sink)
+{
+  cogl_gst_video_sink_set_default_sample (sink,
+                                          !(effect->flags &
+                                            EFFECT_FLAG_CUSTOM_SAMPLE));
+  cogl_gst_video_sink_set_first_layer (sink,
+                                       (effect->flags &
+                                        EFFECT_FLAG_RESERVE_LAYER) ?
+                                       1 : 0);
+}
@@ -30,4 +30,11 @@
 
 extern const Effect * const effects[N_EFFECTS];
 
+/* Sets the sink options that the effect's flags ask for. This has to
+ * be done before the effect's pipeline is set up each time it becomes
+ * the current effect */
+void
+effect_set_up_sink (const Effect *effect,
+                    CoglGstVideoSink *sink);
+
 #endif /* _EFFECTS_H */
@@ -0,0 +1,202 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <float.h>
+#include <glib.h>
+
+#include "fireworks-sim.h"
+
+/* Units per second per second */
+#define GRAVITY -1.5f
+
+#define TIME_PER_SPARK 0.01f /* in seconds */
+
+typedef struct
+{
+  float size;
+  float x, y;
+  float start_x, start_y;
+
+  /* Velocities are in units per second */
+  float initial_x_velocity;
+  float initial_y_velocity;
+
+  /* Absolute times are kept as doubles so that they don't lose
+   * precision after the player has been running for a long time */
+  double start_time;
+} Firework;
+
+struct _FireworksSim
+{
+  GRand *rand;
+
+  int n_fireworks;
+  Firework *fireworks;
+
+  int n_sparks;
+  int next_spark_num;
+  Spark *sparks;
+  double last_spark_time;
+};
+
+FireworksSim *
+fireworks_sim_new (int n_fireworks,
+                   int n_sparks,
+                   uint32_t seed)
+{
+  FireworksSim *sim;
+  int i;
+
+  g_return_val_if_fail ((n_sparks & (n_sparks - 1)) == 0, NULL);
+
+  sim = g_slice_new (FireworksSim);
+
+  sim->rand = g_rand_new_with_seed (seed);
+
+  sim->n_fireworks = n_fireworks;
+  sim->fireworks = g_new (Firework, n_fireworks);
+
+  for (i = 0; i < n_fireworks; i++)
+    {
+      sim->fireworks[i].x = -FLT_MAX;
+      sim->fireworks[i].y = FLT_MAX;
+      sim->fireworks[i].size = 0.0f;
+      sim->fireworks[i].start_time = 0.0;
+    }
+
+  sim->n_sparks = n_sparks;
+  sim->next_spark_num = 0;
+  sim->sparks = g_new0 (Spark, n_sparks);
+
+  for (i = 0; i < n_sparks; i++)
+    {
+      sim->sparks[i].x = 2.0f;
+      sim->sparks[i].y = 2.0f;
+    }
+
+  sim->last_spark_time = 0.0;
+
+  return sim;
+}
+
+void
+fireworks_sim_update (FireworksSim *sim,
+                      double elapsed)
+{
+  float diff_time;
+  int i;
+
+  /* Update all of the firework's positions */
+  for (i = 0; i < sim->n_fireworks; i++)
+    {
+      Firework *firework = sim->fireworks + i;
+
+      if ((fabsf (firework->x - firework->start_x) > 2.0f) ||
+          firework->y < -1.0f)
+        {
+          firework->size = g_rand_double_range (sim->rand, 0.001f, 0.1f);
+          firework->start_x = 1.0f + firework->size;
+          firework->start_y = -1.0f;
+          firework->initial_x_velocity =
+            g_rand_double_range (sim->rand, -0.1f, -2.0f);
+          firework->initial_y_velocity =
+            g_rand_double_range (sim->rand, 0.1f, 4.0f);
+          firework->start_time = elapsed;
+
+          /* Fire some of the fireworks from the other side */
+          if (g_rand_boolean (sim->rand))
+            {
+              firework->start_x = -firework->start_x;
+              firework->initial_x_velocity = -firework->initial_x_velocity;
+            }
+        }
+
+      diff_time = elapsed - firework->start_time;
+
+      firework->x = (firework->start_x +
+                     firework->initial_x_velocity * diff_time);
+
+      firework->y = ((firework->initial_y_velocity * diff_time +
+                      0.5f * GRAVITY * diff_time * diff_time) +
+                     firework->start_y);
+    }
+
+  diff_time = elapsed - sim->last_spark_time;
+  if (diff_time < 0.0f || diff_time >= TIME_PER_SPARK)
+    {
+      /* Add a new spark for each firework, overwriting the oldest ones */
+      for (i = 0; i < sim->n_fireworks; i++)
+        {
+          Spark *spark = sim->sparks + sim->next_spark_num;
+          Firework *firework = sim->fireworks + i;
+
+          spark->x = (firework->x +
+                      g_rand_double_range (sim->rand,
+                                           -firework->size / 2.0f,
+                                           firework->size / 2.0f));
+          spark->y = (firework->y +
+                      g_rand_double_range (sim->rand,
+                                           -firework->size / 2.0f,
+                                           firework->size / 2.0f));
+
+          sim->next_spark_num = ((sim->next_spark_num + 1) &
+                                 (sim->n_sparks - 1));
+        }
+
+      /* Update the fade of each spark */
+      for (i = 0; i < sim->n_sparks; i++)
+        {
+          /* First spark is the oldest */
+          Spark *spark = sim->sparks + ((sim->next_spark_num + i)
+                                        & (sim->n_sparks - 1));
+          spark->fade = i / (sim->n_sparks - 1.0f);
+        }
+
+      sim->last_spark_time = elapsed;
+    }
+}
+
+const Spark *
+fireworks_sim_get_sparks (FireworksSim *sim)
+{
+  return sim->sparks;
+}
+
+int
+fireworks_sim_get_n_sparks (FireworksSim *sim)
+{
+  return sim->n_sparks;
+}
+
+void
+fireworks_sim_free (FireworksSim *sim)
+{
+  g_free (sim->sparks);
+  g_free (sim->fireworks);
+  g_rand_free (sim->rand);
+
+  g_slice_free (FireworksSim, sim);
+}
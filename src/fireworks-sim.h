@@ -0,0 +1,60 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _FIREWORKS_SIM_H
+#define _FIREWORKS_SIM_H
+
+#include <stdint.h>
+
+/* The simulation for the point sprites effect. This doesn't depend
+ * on Cogl so that it can be driven from the micro-benchmark */
+
+typedef struct
+{
+  float x, y;
+  float fade;
+} Spark;
+
+typedef struct _FireworksSim FireworksSim;
+
+/* n_sparks must be a power of two */
+FireworksSim *
+fireworks_sim_new (int n_fireworks,
+                   int n_sparks,
+                   uint32_t seed);
+
+/* elapsed is the time in seconds since the simulation started */
+void
+fireworks_sim_update (FireworksSim *sim,
+                      double elapsed);
+
+const Spark *
+fireworks_sim_get_sparks (FireworksSim *sim);
+
+int
+fireworks_sim_get_n_sparks (FireworksSim *sim);
+
+void
+fireworks_sim_free (FireworksSim *sim);
+
+#endif /* _FIREWORKS_SIM_H */
@@ -0,0 +1,202 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include "frame-history.h"
+
+#define HISTORY_KEY "sprite-player-frame-history"
+
+/* Enough for the three planes of a YUV frame */
+#define MAX_LAYERS 4
+
+typedef struct
+{
+  int n_layers;
+  int layers[MAX_LAYERS];
+  CoglTexture *textures[MAX_LAYERS];
+} HistoryFrame;
+
+struct _FrameHistory
+{
+  CoglGstVideoSink *sink;
+
+  HistoryFrame *frames;
+  int max_frames;
+  int n_frames;
+  /* Index of the latest frame */
+  int latest;
+
+  /* Number of frames before the latest one that is being shown */
+  int offset;
+
+  /* Set when the sink has a frame that hasn't been recorded yet */
+  bool need_record;
+};
+
+FrameHistory *
+frame_history_new (CoglGstVideoSink *sink,
+                   int max_frames)
+{
+  FrameHistory *history = g_slice_new0 (FrameHistory);
+
+  history->sink = sink;
+  history->max_frames = max_frames;
+  history->frames = g_new0 (HistoryFrame, max_frames);
+
+  g_object_set_data (G_OBJECT (sink), HISTORY_KEY, history);
+
+  return history;
+}
+
+static void
+clear_frame (HistoryFrame *frame)
+{
+  int i;
+
+  for (i = 0; i < frame->n_layers; i++)
+    cogl_object_unref (frame->textures[i]);
+
+  frame->n_layers = 0;
+}
+
+void
+frame_history_add (FrameHistory *history)
+{
+  history->offset = 0;
+  history->need_record = true;
+}
+
+void
+frame_history_record (CoglGstVideoSink *sink,
+                      CoglPipeline *pipeline)
+{
+  FrameHistory *history = g_object_get_data (G_OBJECT (sink), HISTORY_KEY);
+  HistoryFrame *frame;
+  CoglTexture *texture;
+  int free_layer, layer;
+
+  if (history == NULL || !history->need_record)
+    return;
+
+  history->need_record = false;
+
+  history->latest = (history->latest + 1) % history->max_frames;
+  frame = history->frames + history->latest;
+  clear_frame (frame);
+
+  /* The frame is attached to the layers just before the sink's free
+   * layer */
+  free_layer = cogl_gst_video_sink_get_free_layer (sink);
+
+  for (layer = 0; layer < free_layer && frame->n_layers < MAX_LAYERS; layer++)
+    {
+      texture = cogl_pipeline_get_layer_texture (pipeline, layer);
+
+      if (texture)
+        {
+          frame->layers[frame->n_layers] = layer;
+          frame->textures[frame->n_layers] = cogl_object_ref (texture);
+          frame->n_layers++;
+        }
+    }
+
+  if (history->n_frames < history->max_frames)
+    history->n_frames++;
+}
+
+void
+frame_history_clear (FrameHistory *history)
+{
+  int i;
+
+  for (i = 0; i < history->max_frames; i++)
+    clear_frame (history->frames + i);
+
+  history->n_frames = 0;
+  history->offset = 0;
+  history->need_record = false;
+}
+
+bool
+frame_history_step_back (FrameHistory *history)
+{
+  if (history->offset + 1 >= history->n_frames)
+    return false;
+
+  history->offset++;
+
+  return true;
+}
+
+bool
+frame_history_step_forward (FrameHistory *history)
+{
+  if (history->offset <= 0)
+    return false;
+
+  history->offset--;
+
+  return true;
+}
+
+bool
+frame_history_attach_frame (CoglGstVideoSink *sink,
+                            CoglPipeline *pipeline)
+{
+  FrameHistory *history = g_object_get_data (G_OBJECT (sink), HISTORY_KEY);
+  HistoryFrame *frame;
+  int i;
+
+  if (history == NULL || history->offset == 0)
+    return false;
+
+  frame = history->frames + ((history->latest + history->max_frames -
+                              history->offset) %
+                             history->max_frames);
+
+  for (i = 0; i < frame->n_layers; i++)
+    cogl_pipeline_set_layer_texture (pipeline,
+                                     frame->layers[i],
+                                     frame->textures[i]);
+
+  return true;
+}
+
+bool
+frame_history_is_recording (CoglGstVideoSink *sink)
+{
+  return g_object_get_data (G_OBJECT (sink), HISTORY_KEY) != NULL;
+}
+
+void
+frame_history_free (FrameHistory *history)
+{
+  frame_history_clear (history);
+
+  g_object_set_data (G_OBJECT (history->sink), HISTORY_KEY, NULL);
+
+  g_free (history->frames);
+
+  g_slice_free (FrameHistory, history);
+}
@@ -0,0 +1,86 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _FRAME_HISTORY_H
+#define _FRAME_HISTORY_H
+
+#include <stdbool.h>
+#include <cogl/cogl.h>
+#include <cogl-gst/cogl-gst.h>
+
+/* Keeps the textures of the last few frames that were painted so that
+ * stepping back through them doesn't need a seek. No copies are made
+ * because the sink creates new textures for each frame and the
+ * texture uploader doesn't reuse its textures while there is a
+ * history. The textures are taken from the effect's pipeline once
+ * texture_uploader_retarget_frame() has attached a new frame to it.
+ * While an old frame is being shown texture_uploader_attach_frame()
+ * attaches it instead of the latest one. This must only be used from
+ * the thread that paints */
+
+typedef struct _FrameHistory FrameHistory;
+
+FrameHistory *
+frame_history_new (CoglGstVideoSink *sink,
+                   int max_frames);
+
+/* Called whenever the sink has a new frame. This goes back to showing
+ * the latest frame which will be recorded the next time it is
+ * attached to a pipeline */
+void
+frame_history_add (FrameHistory *history);
+
+/* Called with a pipeline that the latest frame has just been attached
+ * to. The frame's textures are recorded if it is new */
+void
+frame_history_record (CoglGstVideoSink *sink,
+                      CoglPipeline *pipeline);
+
+/* Throws away the frames, for example because of a seek or because
+ * the effect changed. The recorded layers can include the effect's
+ * own textures */
+void
+frame_history_clear (FrameHistory *history);
+
+/* Returns false if there are no older frames */
+bool
+frame_history_step_back (FrameHistory *history);
+
+/* Returns false if the latest frame is already being shown */
+bool
+frame_history_step_forward (FrameHistory *history);
+
+/* Attaches the old frame being shown, if any, to the pipeline. Returns
+ * false if the latest frame should be used */
+bool
+frame_history_attach_frame (CoglGstVideoSink *sink,
+                            CoglPipeline *pipeline);
+
+/* Returns true if a FrameHistory is keeping the sink's frames */
+bool
+frame_history_is_recording (CoglGstVideoSink *sink);
+
+void
+frame_history_free (FrameHistory *history);
+
+#endif /* _FRAME_HISTORY_H */
@@ -0,0 +1,209 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include "frame-queue.h"
+
+struct _FrameQueue
+{
+  unsigned int max_depth;
+  /* The size of the ring which is a power of two */
+  unsigned int size;
+  QueuedFrame *frames;
+
+  /* These only ever increase and are allowed to wrap around. head is
+   * only written by the streaming thread and tail only by the render
+   * thread */
+  unsigned int head;
+  unsigned int tail;
+
+  /* Written by the streaming thread. The frames before discard_pos
+   * will never be handed over because of a flush and the frames
+   * before overflow_pos arrived before the last frame that didn't fit
+   * in the queue */
+  unsigned int discard_pos;
+  unsigned int overflow_pos;
+
+  int n_overflows;
+};
+
+FrameQueue *
+frame_queue_new (int max_depth)
+{
+  FrameQueue *queue = g_slice_new0 (FrameQueue);
+
+  queue->max_depth = MAX (max_depth, 1);
+
+  for (queue->size = 1; queue->size < queue->max_depth; queue->size *= 2);
+
+  queue->frames = g_new0 (QueuedFrame, queue->size);
+
+  return queue;
+}
+
+static unsigned int
+get_head (FrameQueue *queue)
+{
+  return g_atomic_int_get ((int *) &queue->head);
+}
+
+static unsigned int
+get_tail (FrameQueue *queue)
+{
+  return g_atomic_int_get ((int *) &queue->tail);
+}
+
+bool
+frame_queue_push (FrameQueue *queue,
+                  GstBuffer *buffer,
+                  int64_t arrival_time)
+{
+  QueuedFrame *frame;
+
+  if (queue->head - get_tail (queue) >= queue->max_depth)
+    {
+      g_atomic_int_set ((int *) &queue->overflow_pos, queue->head);
+      g_atomic_int_inc (&queue->n_overflows);
+      return false;
+    }
+
+  frame = queue->frames + (queue->head & (queue->size - 1));
+  frame->buffer = gst_buffer_ref (buffer);
+  frame->arrival_time = arrival_time;
+
+  /* The atomic store is a full barrier so the frame is written before
+   * the render thread can see it */
+  g_atomic_int_set ((int *) &queue->head, queue->head + 1);
+
+  return true;
+}
+
+/* Releases the frames before pos if it is within the queue. Returns
+ * the number of frames released */
+static int
+release_to (FrameQueue *queue,
+            unsigned int head,
+            unsigned int pos)
+{
+  unsigned int tail = queue->tail;
+  QueuedFrame *frame;
+  int n_released;
+
+  /* The position may be left over from before the render thread had
+   * already moved past it */
+  if (pos - tail > head - tail)
+    return 0;
+
+  n_released = pos - tail;
+
+  for (; tail != pos; tail++)
+    {
+      frame = queue->frames + (tail & (queue->size - 1));
+      gst_buffer_unref (frame->buffer);
+      frame->buffer = NULL;
+    }
+
+  g_atomic_int_set ((int *) &queue->tail, pos);
+
+  return n_released;
+}
+
+bool
+frame_queue_pop_to (FrameQueue *queue,
+                    GstBuffer *buffer,
+                    QueuedFrame *frame_out,
+                    int *n_skipped)
+{
+  unsigned int head = get_head (queue);
+  unsigned int pos;
+  QueuedFrame *frame;
+
+  /* The frames before a flush are never going to be handed over.
+   * They were thrown away on purpose so they don't count as
+   * skipped */
+  release_to (queue, head, g_atomic_int_get ((int *) &queue->discard_pos));
+  *n_skipped = 0;
+
+  for (pos = queue->tail; pos != head; pos++)
+    if (queue->frames[pos & (queue->size - 1)].buffer == buffer)
+      break;
+
+  if (pos == head)
+    {
+      /* The buffer didn't fit in the queue. The frames that arrived
+       * before it were either dropped by the sink or are being
+       * skipped so they are released to make space again */
+      *n_skipped +=
+        release_to (queue,
+                    head,
+                    g_atomic_int_get ((int *) &queue->overflow_pos));
+      return false;
+    }
+
+  /* The frames before it were either dropped by the sink for being
+   * late or replaced before the render thread got to them */
+  *n_skipped += release_to (queue, head, pos);
+
+  frame = queue->frames + (pos & (queue->size - 1));
+  *frame_out = *frame;
+  frame->buffer = NULL;
+
+  g_atomic_int_set ((int *) &queue->tail, pos + 1);
+
+  return true;
+}
+
+void
+frame_queue_discard (FrameQueue *queue)
+{
+  g_atomic_int_set ((int *) &queue->discard_pos, get_head (queue));
+}
+
+int
+frame_queue_get_depth (FrameQueue *queue)
+{
+  return get_head (queue) - get_tail (queue);
+}
+
+int
+frame_queue_get_n_overflows (FrameQueue *queue)
+{
+  return g_atomic_int_get (&queue->n_overflows);
+}
+
+void
+frame_queue_free (FrameQueue *queue)
+{
+  QueuedFrame *frame;
+
+  for (; queue->tail != queue->head; queue->tail++)
+    {
+      frame = queue->frames + (queue->tail & (queue->size - 1));
+      gst_buffer_unref (frame->buffer);
+    }
+
+  g_free (queue->frames);
+
+  g_slice_free (FrameQueue, queue);
+}
@@ -0,0 +1,87 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _FRAME_QUEUE_H
+#define _FRAME_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <gst/gst.h>
+
+/* A bounded lock-free queue of the frames that have reached the video
+ * sink. The streaming thread pushes each buffer as it arrives and the
+ * render thread removes them once the sink has handed them over. That
+ * way the renderer knows when each frame arrived and how many were
+ * skipped because it fell behind */
+
+typedef struct
+{
+  GstBuffer *buffer;
+  /* Monotonic time in nanoseconds when the buffer reached the sink */
+  int64_t arrival_time;
+} QueuedFrame;
+
+typedef struct _FrameQueue FrameQueue;
+
+FrameQueue *
+frame_queue_new (int max_depth);
+
+/* Called from the streaming thread. A reference is taken on the
+ * buffer. Returns false if the queue is already full in which case
+ * the frame isn't queued */
+bool
+frame_queue_push (FrameQueue *queue,
+                  GstBuffer *buffer,
+                  int64_t arrival_time);
+
+/* Removes the frames up to and including the one for buffer so that
+ * the renderer skips straight to the newest frame. The reference in
+ * frame_out is transferred to the caller. The number of frames that
+ * were skipped over is returned in n_skipped. If the buffer isn't
+ * queued because the queue was full when it arrived then the frames
+ * that arrived before it are removed instead and false is
+ * returned. Frames before the last call to frame_queue_discard() are
+ * always removed without being counted in n_skipped */
+bool
+frame_queue_pop_to (FrameQueue *queue,
+                    GstBuffer *buffer,
+                    QueuedFrame *frame_out,
+                    int *n_skipped);
+
+/* Marks all of the queued frames as stale after a flush so that the
+ * render thread releases them. This must be called from the
+ * streaming thread or while it is stopped */
+void
+frame_queue_discard (FrameQueue *queue);
+
+/* These can be called from any thread */
+int
+frame_queue_get_depth (FrameQueue *queue);
+
+int
+frame_queue_get_n_overflows (FrameQueue *queue);
+
+void
+frame_queue_free (FrameQueue *queue);
+
+#endif /* _FRAME_QUEUE_H */
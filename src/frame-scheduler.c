@@ -0,0 +1,261 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "frame-scheduler.h"
+#include "trace.h"
+
+#define DEFAULT_REFRESH_INTERVAL (G_GINT64_CONSTANT (1000000000) / 60)
+
+/* If a presentation time is further than this from the monotonic
+ * clock then it's assumed to be on some other clock */
+#define MAX_CLOCK_DIFFERENCE G_GINT64_CONSTANT (1000000000)
+
+struct _FrameScheduler
+{
+  bool has_display;
+  int swap_interval;
+
+  Stats *stats;
+
+  FrameSchedulerPaintFunc paint_func;
+  void *user_data;
+
+  bool have_frame;
+  int64_t frame_target_time;
+  /* The pending paint was only queued to repaint the last frame, for
+   * example after an effect switch, so replacing it isn't a drop */
+  bool pending_is_repaint;
+
+  /* True after painting until the swap completes */
+  bool swap_pending;
+
+  int64_t last_vblank;
+  int64_t refresh_interval;
+
+  /* Timeout to paint a frame that was held back for a later vblank */
+  unsigned int hold_source;
+};
+
+static int64_t
+get_time (void)
+{
+  return g_get_monotonic_time () * 1000;
+}
+
+FrameScheduler *
+frame_scheduler_new (bool has_display,
+                     Stats *stats,
+                     FrameSchedulerPaintFunc paint_func,
+                     void *user_data)
+{
+  FrameScheduler *scheduler = g_slice_new0 (FrameScheduler);
+
+  scheduler->has_display = has_display;
+  scheduler->swap_interval = 1;
+  scheduler->stats = stats;
+  scheduler->paint_func = paint_func;
+  scheduler->user_data = user_data;
+  scheduler->refresh_interval = DEFAULT_REFRESH_INTERVAL;
+
+  return scheduler;
+}
+
+void
+frame_scheduler_set_swap_interval (FrameScheduler *scheduler,
+                                   int swap_interval)
+{
+  scheduler->swap_interval = swap_interval;
+}
+
+static int64_t
+get_next_vblank (FrameScheduler *scheduler,
+                 int64_t now)
+{
+  int64_t interval = scheduler->refresh_interval * scheduler->swap_interval;
+  int64_t n_intervals;
+
+  /* The presentation time can be slightly ahead of the clock */
+  if (now < scheduler->last_vblank)
+    return scheduler->last_vblank;
+
+  n_intervals = (now - scheduler->last_vblank) / interval + 1;
+
+  return scheduler->last_vblank + n_intervals * interval;
+}
+
+static void try_paint (FrameScheduler *scheduler);
+
+static gboolean
+hold_timeout_cb (void *user_data)
+{
+  FrameScheduler *scheduler = user_data;
+
+  scheduler->hold_source = 0;
+  try_paint (scheduler);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+hold_frame (FrameScheduler *scheduler,
+            int64_t until)
+{
+  int64_t delay_ms = (until - get_time () + 999999) / 1000000;
+
+  if (scheduler->hold_source)
+    return;
+
+  scheduler->hold_source = g_timeout_add (MAX (delay_ms, 0),
+                                          hold_timeout_cb,
+                                          scheduler);
+}
+
+/* Returns false if the frame should be held back for a later vblank */
+static bool
+check_frame_time (FrameScheduler *scheduler)
+{
+  int64_t now, next_vblank, half_interval;
+
+  /* Without a display or a vblank to aim for, frames are painted as
+   * soon as possible */
+  if (!scheduler->has_display ||
+      scheduler->swap_interval <= 0 ||
+      scheduler->last_vblank == 0 ||
+      scheduler->frame_target_time < 0)
+    return true;
+
+  now = get_time ();
+  next_vblank = get_next_vblank (scheduler, now);
+  half_interval = scheduler->refresh_interval * scheduler->swap_interval / 2;
+
+  /* If the frame is closer to a later vblank then wait until the
+   * next one has passed. Rounding to the nearest vblank gives a
+   * steady cadence such as 3:2 for 24fps on a 60Hz display */
+  if (scheduler->frame_target_time >= next_vblank + half_interval)
+    {
+      hold_frame (scheduler, next_vblank);
+      return false;
+    }
+
+  /* The vblank that this frame should have been shown at has
+   * already passed */
+  if (scheduler->frame_target_time < next_vblank - half_interval)
+    scheduler->stats->frames_painted_late++;
+
+  return true;
+}
+
+static void
+try_paint (FrameScheduler *scheduler)
+{
+  int64_t trace_start = trace_begin ();
+
+  if (scheduler->have_frame &&
+      !scheduler->swap_pending &&
+      check_frame_time (scheduler))
+    {
+      scheduler->have_frame = false;
+      scheduler->swap_pending = scheduler->has_display;
+
+      scheduler->paint_func (scheduler->user_data);
+    }
+
+  trace_end ("check-draw", trace_start);
+}
+
+void
+frame_scheduler_frame_arrived (FrameScheduler *scheduler,
+                               int64_t target_time)
+{
+  /* If the last frame hasn't been painted yet then it will never be */
+  if (scheduler->have_frame && !scheduler->pending_is_repaint)
+    scheduler->stats->frames_dropped++;
+
+  scheduler->have_frame = true;
+  scheduler->pending_is_repaint = false;
+  scheduler->frame_target_time = target_time;
+
+  try_paint (scheduler);
+}
+
+void
+frame_scheduler_queue_repaint (FrameScheduler *scheduler)
+{
+  if (scheduler->have_frame)
+    return;
+
+  scheduler->have_frame = true;
+  scheduler->pending_is_repaint = true;
+  scheduler->frame_target_time = -1;
+
+  try_paint (scheduler);
+}
+
+void
+frame_scheduler_sync (FrameScheduler *scheduler)
+{
+  scheduler->swap_pending = false;
+
+  /* If there is no presentation time then the best guess for the
+   * vblank is when the swap completed */
+  if (scheduler->last_vblank == 0)
+    scheduler->last_vblank = get_time ();
+
+  try_paint (scheduler);
+}
+
+void
+frame_scheduler_presented (FrameScheduler *scheduler,
+                           int64_t presentation_time,
+                           float refresh_rate)
+{
+  int64_t now = get_time ();
+
+  if (refresh_rate > 0.0f)
+    scheduler->refresh_interval = 1e9 / refresh_rate;
+
+  if (presentation_time != 0 &&
+      ABS (presentation_time - now) < MAX_CLOCK_DIFFERENCE)
+    scheduler->last_vblank = presentation_time;
+  else
+    scheduler->last_vblank = now;
+}
+
+int64_t
+frame_scheduler_get_refresh_interval (FrameScheduler *scheduler)
+{
+  return scheduler->refresh_interval;
+}
+
+void
+frame_scheduler_free (FrameScheduler *scheduler)
+{
+  if (scheduler->hold_source)
+    g_source_remove (scheduler->hold_source);
+
+  g_slice_free (FrameScheduler, scheduler);
+}
@@ -0,0 +1,87 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _FRAME_SCHEDULER_H
+#define _FRAME_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stats.h"
+
+/* Decides when to paint each video frame. Frames are held back until
+ * the vblank closest to their presentation time so that content with
+ * a lower frame rate than the display gets a consistent pulldown
+ * cadence. All times are in nanoseconds on the monotonic clock */
+
+typedef struct _FrameScheduler FrameScheduler;
+
+typedef void
+(* FrameSchedulerPaintFunc) (void *user_data);
+
+/* If has_display is false then the frames are painted as soon as they
+ * arrive without waiting for a swap to complete. The scheduler
+ * updates the dropped and late frame counts in stats */
+FrameScheduler *
+frame_scheduler_new (bool has_display,
+                     Stats *stats,
+                     FrameSchedulerPaintFunc paint_func,
+                     void *user_data);
+
+/* The number of vblanks between each swap. 0 means the swaps aren't
+ * synchronised to the display so frames are never held back */
+void
+frame_scheduler_set_swap_interval (FrameScheduler *scheduler,
+                                   int swap_interval);
+
+/* target_time is when the frame should be presented or -1 if it isn't
+ * known. A frame that hasn't been painted yet is replaced */
+void
+frame_scheduler_frame_arrived (FrameScheduler *scheduler,
+                               int64_t target_time);
+
+/* Paints the last frame again, for example because the effect has
+ * changed while the video is paused. Unlike a new frame this doesn't
+ * replace one that is already waiting */
+void
+frame_scheduler_queue_repaint (FrameScheduler *scheduler);
+
+/* Called when the last swap has completed and we can draw again */
+void
+frame_scheduler_sync (FrameScheduler *scheduler);
+
+/* Called when a frame has been presented. presentation_time is
+ * ignored if it is 0 or doesn't look like it is on the monotonic
+ * clock. refresh_rate is ignored if it is 0 */
+void
+frame_scheduler_presented (FrameScheduler *scheduler,
+                           int64_t presentation_time,
+                           float refresh_rate);
+
+int64_t
+frame_scheduler_get_refresh_interval (FrameScheduler *scheduler);
+
+void
+frame_scheduler_free (FrameScheduler *scheduler);
+
+#endif /* _FRAME_SCHEDULER_H */
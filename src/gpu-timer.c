@@ -0,0 +1,252 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <glib.h>
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include "gpu-timer.h"
+#include "histogram.h"
+#include "effects.h"
+
+/* Number of frames that can be waiting for a result before we start
+ * skipping frames */
+#define N_QUERIES 8
+
+typedef struct
+{
+  GLuint id;
+  int effect_num;
+  uint64_t cpu_time;
+} Query;
+
+struct _GpuTimer
+{
+  PFNGLGENQUERIESPROC GenQueries;
+  PFNGLDELETEQUERIESPROC DeleteQueries;
+  PFNGLBEGINQUERYPROC BeginQuery;
+  PFNGLENDQUERYPROC EndQuery;
+  PFNGLGETQUERYOBJECTIVPROC GetQueryObjectiv;
+  PFNGLGETQUERYOBJECTUI64VPROC GetQueryObjectui64v;
+
+  Query queries[N_QUERIES];
+  int first_pending;
+  int n_pending;
+
+  /* The query that is between begin and end or -1 if this frame is
+   * being skipped */
+  int current_query;
+
+  int n_skipped;
+
+  Histogram *gpu_time[N_EFFECTS];
+  Histogram *cpu_time[N_EFFECTS];
+};
+
+GpuTimer *
+gpu_timer_new (void)
+{
+  GpuTimer *timer;
+  GLuint ids[N_QUERIES];
+  int i;
+
+  if (!SDL_GL_ExtensionSupported ("GL_ARB_timer_query"))
+    return NULL;
+
+  timer = g_slice_new0 (GpuTimer);
+
+  timer->GenQueries = SDL_GL_GetProcAddress ("glGenQueries");
+  timer->DeleteQueries = SDL_GL_GetProcAddress ("glDeleteQueries");
+  timer->BeginQuery = SDL_GL_GetProcAddress ("glBeginQuery");
+  timer->EndQuery = SDL_GL_GetProcAddress ("glEndQuery");
+  timer->GetQueryObjectiv = SDL_GL_GetProcAddress ("glGetQueryObjectiv");
+  timer->GetQueryObjectui64v =
+    SDL_GL_GetProcAddress ("glGetQueryObjectui64v");
+
+  if (timer->GenQueries == NULL ||
+      timer->DeleteQueries == NULL ||
+      timer->BeginQuery == NULL ||
+      timer->EndQuery == NULL ||
+      timer->GetQueryObjectiv == NULL ||
+      timer->GetQueryObjectui64v == NULL)
+    {
+      g_slice_free (GpuTimer, timer);
+      return NULL;
+    }
+
+  timer->GenQueries (N_QUERIES, ids);
+
+  for (i = 0; i < N_QUERIES; i++)
+    timer->queries[i].id = ids[i];
+
+  timer->current_query = -1;
+
+  for (i = 0; i < N_EFFECTS; i++)
+    {
+      timer->gpu_time[i] = histogram_new ();
+      timer->cpu_time[i] = histogram_new ();
+    }
+
+  return timer;
+}
+
+static void
+collect_results (GpuTimer *timer)
+{
+  while (timer->n_pending > 0)
+    {
+      Query *query = timer->queries + timer->first_pending;
+      GLint available;
+      GLuint64 gpu_time;
+
+      timer->GetQueryObjectiv (query->id,
+                               GL_QUERY_RESULT_AVAILABLE,
+                               &available);
+
+      /* The results become available in order so there's no point
+       * in checking the rest */
+      if (!available)
+        break;
+
+      timer->GetQueryObjectui64v (query->id, GL_QUERY_RESULT, &gpu_time);
+
+      histogram_add (timer->gpu_time[query->effect_num], gpu_time);
+      histogram_add (timer->cpu_time[query->effect_num], query->cpu_time);
+
+      timer->first_pending = (timer->first_pending + 1) % N_QUERIES;
+      timer->n_pending--;
+    }
+}
+
+void
+gpu_timer_begin (GpuTimer *timer,
+                 int effect_num)
+{
+  Query *query;
+
+  collect_results (timer);
+
+  /* If the GPU is so far behind that all of the queries are still
+   * pending then this frame is skipped rather than waiting */
+  if (timer->n_pending >= N_QUERIES)
+    {
+      timer->current_query = -1;
+      timer->n_skipped++;
+      return;
+    }
+
+  timer->current_query = ((timer->first_pending + timer->n_pending) %
+                          N_QUERIES);
+  query = timer->queries + timer->current_query;
+  query->effect_num = effect_num;
+
+  timer->BeginQuery (GL_TIME_ELAPSED, query->id);
+}
+
+void
+gpu_timer_end (GpuTimer *timer,
+               uint64_t cpu_time)
+{
+  if (timer->current_query == -1)
+    return;
+
+  timer->EndQuery (GL_TIME_ELAPSED);
+
+  timer->queries[timer->current_query].cpu_time = cpu_time;
+  timer->n_pending++;
+  timer->current_query = -1;
+}
+
+static void
+print_times (FILE *out,
+             const Histogram *histogram)
+{
+  fprintf (out,
+           " %8.3f %8.3f %8.3f",
+           histogram_get_mean (histogram) / 1e6,
+           histogram_get_percentile (histogram, 50.0) / 1e6,
+           histogram_get_percentile (histogram, 99.0) / 1e6);
+}
+
+void
+gpu_timer_print_report (GpuTimer *timer,
+                        FILE *out)
+{
+  int i;
+
+  collect_results (timer);
+
+  fprintf (out,
+           "%-20s %8s %26s %26s\n"
+           "%-20s %8s %8s %8s %8s %8s %8s %8s\n",
+           "", "",
+           "CPU time (ms)", "GPU time (ms)",
+           "Effect", "Frames",
+           "mean", "p50", "p99",
+           "mean", "p50", "p99");
+
+  for (i = 0; i < N_EFFECTS; i++)
+    {
+      uint64_t count = histogram_get_count (timer->gpu_time[i]);
+
+      if (count == 0)
+        continue;
+
+      fprintf (out,
+               "%-20s %8" G_GUINT64_FORMAT,
+               effects[i]->name,
+               (guint64) count);
+      print_times (out, timer->cpu_time[i]);
+      print_times (out, timer->gpu_time[i]);
+      fputc ('\n', out);
+    }
+
+  if (timer->n_skipped > 0)
+    fprintf (out,
+             "%i frames weren't timed because the GPU was too far "
+             "behind\n",
+             timer->n_skipped);
+}
+
+void
+gpu_timer_free (GpuTimer *timer)
+{
+  GLuint ids[N_QUERIES];
+  int i;
+
+  for (i = 0; i < N_QUERIES; i++)
+    ids[i] = timer->queries[i].id;
+
+  timer->DeleteQueries (N_QUERIES, ids);
+
+  for (i = 0; i < N_EFFECTS; i++)
+    {
+      histogram_free (timer->gpu_time[i]);
+      histogram_free (timer->cpu_time[i]);
+    }
+
+  g_slice_free (GpuTimer, timer);
+}
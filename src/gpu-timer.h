@@ -0,0 +1,63 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _GPU_TIMER_H
+#define _GPU_TIMER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Measures the GPU time taken by each frame using
+ * GL_ARB_timer_query. The results are read back a few frames later
+ * so that the CPU never has to wait for the GPU. They are recorded
+ * per effect along with the CPU time for the same frame */
+
+typedef struct _GpuTimer GpuTimer;
+
+/* Returns NULL if timer queries aren't supported. The Cogl context
+ * must be current */
+GpuTimer *
+gpu_timer_new (void);
+
+/* Starts timing a frame for the given effect and collects the
+ * results of any earlier frames that have finished */
+void
+gpu_timer_begin (GpuTimer *timer,
+                 int effect_num);
+
+/* The GPU time includes all of the GL commands up to this call so
+ * Cogl's journal should be flushed first. It should be called before
+ * the swap so that the time doesn't include it. cpu_time is recorded
+ * alongside it */
+void
+gpu_timer_end (GpuTimer *timer,
+               uint64_t cpu_time);
+
+void
+gpu_timer_print_report (GpuTimer *timer,
+                        FILE *out);
+
+void
+gpu_timer_free (GpuTimer *timer);
+
+#endif /* _GPU_TIMER_H */
@@ -0,0 +1,173 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+
+#include "histogram.h"
+
+#define SUB_BUCKET_BITS 4
+#define N_SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+/* Values below N_SUB_BUCKETS get a bucket each. After that every
+ * power of two is split into N_SUB_BUCKETS */
+#define N_BUCKETS (N_SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1))
+
+struct _Histogram
+{
+  uint64_t count;
+  uint64_t min, max;
+  double sum;
+
+  uint32_t buckets[N_BUCKETS];
+};
+
+static int
+get_bucket (uint64_t value)
+{
+  int msb, shift;
+
+  if (value < N_SUB_BUCKETS)
+    return value;
+
+  msb = 63 - __builtin_clzll (value);
+  shift = msb - SUB_BUCKET_BITS;
+
+  return (N_SUB_BUCKETS * (shift + 1) +
+          (int) ((value >> shift) - N_SUB_BUCKETS));
+}
+
+static uint64_t
+get_bucket_middle (int bucket)
+{
+  int shift;
+  uint64_t sub_bucket;
+
+  if (bucket < N_SUB_BUCKETS)
+    return bucket;
+
+  shift = bucket / N_SUB_BUCKETS - 1;
+  sub_bucket = bucket % N_SUB_BUCKETS;
+
+  return (((N_SUB_BUCKETS + sub_bucket) << shift) +
+          ((UINT64_C (1) << shift) >> 1));
+}
+
+Histogram *
+histogram_new (void)
+{
+  Histogram *histogram = g_slice_new (Histogram);
+
+  histogram_reset (histogram);
+
+  return histogram;
+}
+
+void
+histogram_add (Histogram *histogram,
+               uint64_t value)
+{
+  if (histogram->count == 0 || value < histogram->min)
+    histogram->min = value;
+  if (value > histogram->max)
+    histogram->max = value;
+
+  histogram->count++;
+  histogram->sum += value;
+  histogram->buckets[get_bucket (value)]++;
+}
+
+void
+histogram_reset (Histogram *histogram)
+{
+  memset (histogram, 0, sizeof (Histogram));
+}
+
+uint64_t
+histogram_get_count (const Histogram *histogram)
+{
+  return histogram->count;
+}
+
+uint64_t
+histogram_get_min (const Histogram *histogram)
+{
+  return histogram->min;
+}
+
+uint64_t
+histogram_get_max (const Histogram *histogram)
+{
+  return histogram->max;
+}
+
+double
+histogram_get_mean (const Histogram *histogram)
+{
+  if (histogram->count == 0)
+    return 0.0;
+
+  return histogram->sum / histogram->count;
+}
+
+uint64_t
+histogram_get_percentile (const Histogram *histogram,
+                          double percentile)
+{
+  uint64_t target, total = 0;
+  uint64_t value;
+  int i;
+
+  if (histogram->count == 0)
+    return 0;
+
+  target = ceil (histogram->count * percentile / 100.0);
+  if (target < 1)
+    target = 1;
+
+  for (i = 0; i < N_BUCKETS; i++)
+    {
+      total += histogram->buckets[i];
+
+      if (total >= target)
+        break;
+    }
+
+  value = get_bucket_middle (i);
+
+  /* The real values can't be outside of the recorded range */
+  if (value < histogram->min)
+    return histogram->min;
+  if (value > histogram->max)
+    return histogram->max;
+
+  return value;
+}
+
+void
+histogram_free (Histogram *histogram)
+{
+  g_slice_free (Histogram, histogram);
+}
@@ -0,0 +1,66 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+#include <stdint.h>
+
+/* A histogram of durations in nanoseconds. The buckets are spaced
+ * logarithmically with 16 buckets per power of two so any value can
+ * be recorded in constant time and space and the percentiles are
+ * accurate to within about 3% */
+
+typedef struct _Histogram Histogram;
+
+Histogram *
+histogram_new (void);
+
+void
+histogram_add (Histogram *histogram,
+               uint64_t value);
+
+void
+histogram_reset (Histogram *histogram);
+
+uint64_t
+histogram_get_count (const Histogram *histogram);
+
+uint64_t
+histogram_get_min (const Histogram *histogram);
+
+uint64_t
+histogram_get_max (const Histogram *histogram);
+
+double
+histogram_get_mean (const Histogram *histogram);
+
+/* percentile is in the range [0,100] */
+uint64_t
+histogram_get_percentile (const Histogram *histogram,
+                          double percentile);
+
+void
+histogram_free (Histogram *histogram);
+
+#endif /* _HISTOGRAM_H */
@@ -0,0 +1,433 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gst/video/video.h>
+
+#include "image-sequence.h"
+
+/* Each slot holds one image that has been or is being decoded */
+typedef struct
+{
+  int64_t frame_num;
+  GdkPixbuf *pixbuf;
+  bool decoded;
+} DecodeSlot;
+
+struct _ImageSequence
+{
+  char **files;
+  int n_files;
+
+  int frame_rate;
+  GstVideoInfo info;
+  GstCaps *caps;
+
+  GThreadPool *pool;
+
+  /* Protects decoded and pixbuf in the slots */
+  GMutex mutex;
+  GCond cond;
+
+  /* Frame n is decoded into slot n % n_slots */
+  DecodeSlot *slots;
+  int n_slots;
+
+  /* Only used by the appsrc's streaming thread */
+  int64_t next_frame;
+  bool size_warning_shown;
+};
+
+static bool
+is_image_file (const char *filename)
+{
+  return (g_str_has_suffix (filename, ".png") ||
+          g_str_has_suffix (filename, ".PNG") ||
+          g_str_has_suffix (filename, ".jpg") ||
+          g_str_has_suffix (filename, ".JPG") ||
+          g_str_has_suffix (filename, ".jpeg") ||
+          g_str_has_suffix (filename, ".JPEG"));
+}
+
+static int
+compare_filenames (const void *a,
+                   const void *b)
+{
+  return strcmp (* (const char **) a, * (const char **) b);
+}
+
+static char **
+find_files (const char *pattern,
+            GError **error)
+{
+  GPatternSpec *spec = NULL;
+  GPtrArray *files;
+  const char *name;
+  char *dirname;
+  GDir *dir;
+
+  if (g_file_test (pattern, G_FILE_TEST_IS_DIR))
+    {
+      dirname = g_strdup (pattern);
+    }
+  else
+    {
+      char *basename = g_path_get_basename (pattern);
+
+      dirname = g_path_get_dirname (pattern);
+      spec = g_pattern_spec_new (basename);
+      g_free (basename);
+    }
+
+  dir = g_dir_open (dirname, 0, error);
+
+  if (dir == NULL)
+    {
+      g_free (dirname);
+      if (spec)
+        g_pattern_spec_free (spec);
+      return NULL;
+    }
+
+  files = g_ptr_array_new ();
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      if (spec ? g_pattern_match_string (spec, name) : is_image_file (name))
+        g_ptr_array_add (files, g_build_filename (dirname, name, NULL));
+    }
+
+  g_dir_close (dir);
+  g_free (dirname);
+  if (spec)
+    g_pattern_spec_free (spec);
+
+  if (files->len == 0)
+    {
+      g_ptr_array_free (files, TRUE);
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   G_FILE_ERROR_NOENT,
+                   "No images found for '%s'",
+                   pattern);
+      return NULL;
+    }
+
+  qsort (files->pdata, files->len, sizeof (char *), compare_filenames);
+
+  g_ptr_array_add (files, NULL);
+
+  return (char **) g_ptr_array_free (files, FALSE);
+}
+
+static void
+decode_func (void *task_data,
+             void *user_data)
+{
+  DecodeSlot *slot = task_data;
+  ImageSequence *sequence = user_data;
+  const char *filename = sequence->files[slot->frame_num % sequence->n_files];
+  GError *error = NULL;
+  GdkPixbuf *pixbuf;
+
+  pixbuf = gdk_pixbuf_new_from_file (filename, &error);
+
+  if (pixbuf == NULL)
+    {
+      g_warning ("%s", error->message);
+      g_clear_error (&error);
+    }
+
+  g_mutex_lock (&sequence->mutex);
+  slot->pixbuf = pixbuf;
+  slot->decoded = true;
+  g_cond_broadcast (&sequence->cond);
+  g_mutex_unlock (&sequence->mutex);
+}
+
+static void
+queue_decode (ImageSequence *sequence,
+              int64_t frame_num)
+{
+  DecodeSlot *slot = sequence->slots + frame_num % sequence->n_slots;
+
+  /* The slot isn't touched by the pool until it is pushed */
+  slot->frame_num = frame_num;
+  g_thread_pool_push (sequence->pool, slot, NULL);
+}
+
+static bool
+set_info_from_pixbuf (GstVideoInfo *info,
+                      GdkPixbuf *pixbuf,
+                      int frame_rate)
+{
+  GstVideoFormat format;
+
+  if (gdk_pixbuf_get_colorspace (pixbuf) != GDK_COLORSPACE_RGB ||
+      gdk_pixbuf_get_bits_per_sample (pixbuf) != 8)
+    return false;
+
+  format = (gdk_pixbuf_get_has_alpha (pixbuf) ?
+            GST_VIDEO_FORMAT_RGBA :
+            GST_VIDEO_FORMAT_RGB);
+
+  gst_video_info_set_format (info,
+                             format,
+                             gdk_pixbuf_get_width (pixbuf),
+                             gdk_pixbuf_get_height (pixbuf));
+  GST_VIDEO_INFO_FPS_N (info) = frame_rate;
+  GST_VIDEO_INFO_FPS_D (info) = 1;
+
+  return true;
+}
+
+ImageSequence *
+image_sequence_new (const char *pattern,
+                    int frame_rate,
+                    GError **error)
+{
+  ImageSequence *sequence;
+  GdkPixbuf *pixbuf;
+  char **files;
+  int n_threads;
+
+  files = find_files (pattern, error);
+
+  if (files == NULL)
+    return NULL;
+
+  pixbuf = gdk_pixbuf_new_from_file (files[0], error);
+
+  if (pixbuf == NULL)
+    {
+      g_strfreev (files);
+      return NULL;
+    }
+
+  sequence = g_slice_new0 (ImageSequence);
+  sequence->files = files;
+  sequence->n_files = g_strv_length (files);
+  sequence->frame_rate = frame_rate;
+
+  if (!set_info_from_pixbuf (&sequence->info, pixbuf, frame_rate))
+    {
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   G_FILE_ERROR_INVAL,
+                   "Unsupported image format in '%s'",
+                   files[0]);
+      g_object_unref (pixbuf);
+      image_sequence_free (sequence);
+      return NULL;
+    }
+
+  g_object_unref (pixbuf);
+
+  sequence->caps = gst_video_info_to_caps (&sequence->info);
+
+  g_mutex_init (&sequence->mutex);
+  g_cond_init (&sequence->cond);
+
+  /* Two extra slots let the streaming thread take a frame while all
+   * of the threads are busy */
+  n_threads = g_get_num_processors ();
+  sequence->n_slots = n_threads + 2;
+  sequence->slots = g_new0 (DecodeSlot, sequence->n_slots);
+
+  sequence->pool = g_thread_pool_new (decode_func,
+                                      sequence,
+                                      n_threads,
+                                      FALSE, /* exclusive */
+                                      NULL /* error */);
+
+  return sequence;
+}
+
+static void
+free_pixbuf (void *pixbuf)
+{
+  g_object_unref (pixbuf);
+}
+
+static GstBuffer *
+wrap_pixbuf (ImageSequence *sequence,
+             GdkPixbuf *pixbuf)
+{
+  GstVideoInfo *info = &sequence->info;
+  int stride = gdk_pixbuf_get_rowstride (pixbuf);
+  size_t size = stride * (GST_VIDEO_INFO_HEIGHT (info) - 1) +
+    GST_VIDEO_INFO_WIDTH (info) * GST_VIDEO_INFO_COMP_PSTRIDE (info, 0);
+  GstBuffer *buffer;
+  gsize offset = 0;
+
+  /* The buffer keeps the pixbuf alive so the pixels don't have to be
+   * copied. The row stride can be padded so it is given in a meta */
+  buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+                                        gdk_pixbuf_get_pixels (pixbuf),
+                                        size,
+                                        0, /* offset */
+                                        size,
+                                        pixbuf,
+                                        free_pixbuf);
+
+  gst_buffer_add_video_meta_full (buffer,
+                                  GST_VIDEO_FRAME_FLAG_NONE,
+                                  GST_VIDEO_INFO_FORMAT (info),
+                                  GST_VIDEO_INFO_WIDTH (info),
+                                  GST_VIDEO_INFO_HEIGHT (info),
+                                  1, /* n_planes */
+                                  &offset,
+                                  &stride);
+
+  return buffer;
+}
+
+static bool
+pixbuf_matches (ImageSequence *sequence,
+                GdkPixbuf *pixbuf)
+{
+  const GstVideoInfo *expected = &sequence->info;
+  GstVideoInfo info;
+
+  if (set_info_from_pixbuf (&info, pixbuf, sequence->frame_rate) &&
+      GST_VIDEO_INFO_FORMAT (&info) == GST_VIDEO_INFO_FORMAT (expected) &&
+      GST_VIDEO_INFO_WIDTH (&info) == GST_VIDEO_INFO_WIDTH (expected) &&
+      GST_VIDEO_INFO_HEIGHT (&info) == GST_VIDEO_INFO_HEIGHT (expected))
+    return true;
+
+  if (!sequence->size_warning_shown)
+    {
+      g_warning ("Skipping images that don't match the size and format "
+                 "of the first one");
+      sequence->size_warning_shown = true;
+    }
+
+  return false;
+}
+
+static void
+need_data_cb (GstAppSrc *src,
+              guint length,
+              void *user_data)
+{
+  ImageSequence *sequence = user_data;
+  int n_skipped = 0;
+
+  /* Images that failed to load are skipped so that the previous one
+   * stays on screen. The appsrc only asks once so something has to
+   * be pushed before returning */
+  while (n_skipped < sequence->n_files)
+    {
+      int64_t frame_num = sequence->next_frame++;
+      DecodeSlot *slot = sequence->slots + frame_num % sequence->n_slots;
+      GdkPixbuf *pixbuf;
+      GstBuffer *buffer;
+
+      g_mutex_lock (&sequence->mutex);
+      while (!slot->decoded)
+        g_cond_wait (&sequence->cond, &sequence->mutex);
+      pixbuf = slot->pixbuf;
+      slot->pixbuf = NULL;
+      slot->decoded = false;
+      g_mutex_unlock (&sequence->mutex);
+
+      queue_decode (sequence, frame_num + sequence->n_slots);
+
+      if (pixbuf == NULL || !pixbuf_matches (sequence, pixbuf))
+        {
+          if (pixbuf)
+            g_object_unref (pixbuf);
+          n_skipped++;
+          continue;
+        }
+
+      buffer = wrap_pixbuf (sequence, pixbuf);
+      GST_BUFFER_PTS (buffer) =
+        gst_util_uint64_scale_int (frame_num, GST_SECOND,
+                                   sequence->frame_rate);
+      GST_BUFFER_DURATION (buffer) =
+        gst_util_uint64_scale_int (1, GST_SECOND, sequence->frame_rate);
+
+      gst_app_src_push_buffer (src, buffer);
+
+      return;
+    }
+
+  g_warning ("None of the images could be loaded");
+  gst_app_src_end_of_stream (src);
+}
+
+void
+image_sequence_attach (ImageSequence *sequence,
+                       GstAppSrc *src)
+{
+  GstAppSrcCallbacks callbacks;
+  int i;
+
+  gst_app_src_set_caps (src, sequence->caps);
+  gst_app_src_set_stream_type (src, GST_APP_STREAM_TYPE_STREAM);
+  g_object_set (src, "format", GST_FORMAT_TIME, NULL);
+
+  memset (&callbacks, 0, sizeof (callbacks));
+  callbacks.need_data = need_data_cb;
+  gst_app_src_set_callbacks (src, &callbacks, sequence, NULL);
+
+  for (i = 0; i < sequence->n_slots; i++)
+    queue_decode (sequence, i);
+}
+
+void
+image_sequence_free (ImageSequence *sequence)
+{
+  int i;
+
+  if (sequence->pool)
+    {
+      /* Wait for the images being decoded and drop the rest */
+      g_thread_pool_free (sequence->pool,
+                          TRUE, /* immediate */
+                          TRUE /* wait */);
+
+      for (i = 0; i < sequence->n_slots; i++)
+        if (sequence->slots[i].pixbuf)
+          g_object_unref (sequence->slots[i].pixbuf);
+
+      g_free (sequence->slots);
+
+      g_mutex_clear (&sequence->mutex);
+      g_cond_clear (&sequence->cond);
+    }
+
+  if (sequence->caps)
+    gst_caps_unref (sequence->caps);
+
+  g_strfreev (sequence->files);
+
+  g_slice_free (ImageSequence, sequence);
+}
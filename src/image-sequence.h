@@ -0,0 +1,54 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _IMAGE_SEQUENCE_H
+#define _IMAGE_SEQUENCE_H
+
+#include <glib.h>
+#include <gst/app/gstappsrc.h>
+
+/* Plays a sequence of PNG or JPEG images at a fixed frame rate
+ * through an appsrc. The images are decoded ahead of time by a pool
+ * with a thread for each core. The sequence loops forever */
+
+typedef struct _ImageSequence ImageSequence;
+
+/* pattern is either a directory, in which case all of the images in
+ * it are used, or a glob for the file names such as
+ * "frames/shot1-*.png". The files are played in alphabetical order.
+ * The first image is loaded straight away to find the size */
+ImageSequence *
+image_sequence_new (const char *pattern,
+                    int frame_rate,
+                    GError **error);
+
+/* Sets the caps on the appsrc and starts decoding. The sequence can
+ * be freed once the appsrc has stopped */
+void
+image_sequence_attach (ImageSequence *sequence,
+                       GstAppSrc *src);
+
+void
+image_sequence_free (ImageSequence *sequence);
+
+#endif /* _IMAGE_SEQUENCE_H */
@@ -0,0 +1,365 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <glib/gstdio.h>
+#include <gst/video/video.h>
+
+#include "loop-cache.h"
+
+typedef enum
+{
+  LOOP_CACHE_RECORDING,
+  LOOP_CACHE_COMPLETE,
+  LOOP_CACHE_FAILED
+} LoopCacheState;
+
+typedef struct
+{
+  /* Relative to the first frame */
+  GstClockTime pts;
+  GstClockTime duration;
+} CachedFrame;
+
+struct _LoopCache
+{
+  LoopCacheState state;
+
+  uint8_t *data;
+  size_t max_size;
+
+  GstCaps *caps;
+  /* The frames are stored with the default layout for these caps */
+  GstVideoInfo info;
+
+  GArray *frames;
+  GstClockTime first_pts;
+  GstClockTime loop_duration;
+
+  /* These are only used by the appsrc's streaming thread */
+  unsigned int next_frame;
+  unsigned int loop_num;
+};
+
+LoopCache *
+loop_cache_new (size_t max_size,
+                GError **error)
+{
+  LoopCache *cache;
+  char *filename;
+  void *data;
+  int fd;
+
+  fd = g_file_open_tmp ("sprite-player-cache-XXXXXX", &filename, error);
+
+  if (fd == -1)
+    return NULL;
+
+  /* The file is only needed for as long as it is mapped */
+  g_unlink (filename);
+  g_free (filename);
+
+  if (ftruncate (fd, max_size) == -1 ||
+      (data = mmap (NULL, max_size,
+                    PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0)) == MAP_FAILED)
+    {
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   g_file_error_from_errno (errno),
+                   "Failed to map the loop cache: %s",
+                   strerror (errno));
+      close (fd);
+      return NULL;
+    }
+
+  close (fd);
+
+  cache = g_slice_new0 (LoopCache);
+  cache->data = data;
+  cache->max_size = max_size;
+  cache->frames = g_array_new (FALSE, FALSE, sizeof (CachedFrame));
+
+  return cache;
+}
+
+static void
+abandon (LoopCache *cache)
+{
+  cache->state = LOOP_CACHE_FAILED;
+  g_array_set_size (cache->frames, 0);
+}
+
+void
+loop_cache_handle_event (LoopCache *cache,
+                         GstEvent *event)
+{
+  if (cache->state != LOOP_CACHE_RECORDING)
+    return;
+
+  switch (GST_EVENT_TYPE (event))
+    {
+    case GST_EVENT_CAPS:
+      {
+        GstCaps *caps;
+
+        gst_event_parse_caps (event, &caps);
+
+        if (cache->frames->len > 0 &&
+            !gst_caps_is_equal (caps, cache->caps))
+          {
+            abandon (cache);
+          }
+        else if (!gst_video_info_from_caps (&cache->info, caps))
+          {
+            abandon (cache);
+          }
+        else
+          {
+            gst_caps_replace (&cache->caps, caps);
+          }
+        break;
+      }
+
+    case GST_EVENT_FLUSH_STOP:
+      /* The video will start from somewhere else */
+      g_array_set_size (cache->frames, 0);
+      break;
+
+    default:
+      break;
+    }
+}
+
+void
+loop_cache_record (LoopCache *cache,
+                   GstBuffer *buffer)
+{
+  size_t frame_size = GST_VIDEO_INFO_SIZE (&cache->info);
+  size_t offset = cache->frames->len * frame_size;
+  GstVideoFrame src, dst;
+  GstBuffer *wrapper;
+  CachedFrame frame;
+  bool copied = false;
+
+  if (cache->state != LOOP_CACHE_RECORDING || cache->caps == NULL)
+    return;
+
+  if (offset + frame_size > cache->max_size ||
+      !GST_BUFFER_PTS_IS_VALID (buffer))
+    {
+      abandon (cache);
+      return;
+    }
+
+  if (cache->frames->len == 0)
+    cache->first_pts = GST_BUFFER_PTS (buffer);
+
+  wrapper = gst_buffer_new_wrapped_full (0, /* flags */
+                                         cache->data + offset,
+                                         frame_size,
+                                         0, /* offset */
+                                         frame_size,
+                                         NULL, /* user_data */
+                                         NULL /* notify */);
+
+  if (gst_video_frame_map (&src, &cache->info, buffer, GST_MAP_READ))
+    {
+      if (gst_video_frame_map (&dst, &cache->info, wrapper, GST_MAP_WRITE))
+        {
+          copied = gst_video_frame_copy (&dst, &src);
+          gst_video_frame_unmap (&dst);
+        }
+
+      gst_video_frame_unmap (&src);
+    }
+
+  gst_buffer_unref (wrapper);
+
+  if (!copied)
+    {
+      abandon (cache);
+      return;
+    }
+
+  frame.pts = GST_BUFFER_PTS (buffer) - cache->first_pts;
+  frame.duration = GST_BUFFER_DURATION (buffer);
+  g_array_append_val (cache->frames, frame);
+}
+
+void
+loop_cache_reset (LoopCache *cache)
+{
+  cache->state = LOOP_CACHE_RECORDING;
+  g_array_set_size (cache->frames, 0);
+  gst_caps_replace (&cache->caps, NULL);
+}
+
+bool
+loop_cache_finish (LoopCache *cache)
+{
+  const CachedFrame *last;
+  unsigned int n_frames = cache->frames->len;
+
+  if (cache->state != LOOP_CACHE_RECORDING || n_frames < 2)
+    return false;
+
+  last = &g_array_index (cache->frames, CachedFrame, n_frames - 1);
+
+  /* If the decoder didn't give a duration for the last frame then
+   * assume it is the same as the average */
+  if (GST_CLOCK_TIME_IS_VALID (last->duration))
+    cache->loop_duration = last->pts + last->duration;
+  else
+    cache->loop_duration = last->pts * n_frames / (n_frames - 1);
+
+  cache->state = LOOP_CACHE_COMPLETE;
+
+  return true;
+}
+
+bool
+loop_cache_is_complete (LoopCache *cache)
+{
+  return cache->state == LOOP_CACHE_COMPLETE;
+}
+
+static void
+need_data_cb (GstAppSrc *src,
+              guint length,
+              void *user_data)
+{
+  LoopCache *cache = user_data;
+  size_t frame_size = GST_VIDEO_INFO_SIZE (&cache->info);
+  const CachedFrame *frame =
+    &g_array_index (cache->frames, CachedFrame, cache->next_frame);
+  GstBuffer *buffer;
+
+  buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+                                        cache->data +
+                                        cache->next_frame * frame_size,
+                                        frame_size,
+                                        0, /* offset */
+                                        frame_size,
+                                        NULL, /* user_data */
+                                        NULL /* notify */);
+
+  /* The timestamps keep increasing so the appsrc doesn't have to
+   * seek to loop */
+  GST_BUFFER_PTS (buffer) =
+    cache->loop_num * cache->loop_duration + frame->pts;
+  GST_BUFFER_DURATION (buffer) = frame->duration;
+
+  if (++cache->next_frame >= cache->frames->len)
+    {
+      cache->next_frame = 0;
+      cache->loop_num++;
+    }
+
+  gst_app_src_push_buffer (src, buffer);
+}
+
+/* Finds the frame that is showing at a time relative to the start of
+ * the loop */
+static unsigned int
+find_frame (LoopCache *cache,
+            GstClockTime time)
+{
+  unsigned int min = 0, max = cache->frames->len - 1, mid;
+
+  while (min < max)
+    {
+      mid = (min + max + 1) / 2;
+
+      if (g_array_index (cache->frames, CachedFrame, mid).pts <= time)
+        min = mid;
+      else
+        max = mid - 1;
+    }
+
+  return min;
+}
+
+static gboolean
+seek_data_cb (GstAppSrc *src,
+              guint64 offset,
+              void *user_data)
+{
+  LoopCache *cache = user_data;
+
+  /* This is called with the streaming thread stopped. The position
+   * is in the same timeline as the timestamps so it is split into
+   * the loop and the time within it */
+  if (cache->loop_duration > 0)
+    {
+      cache->loop_num = offset / cache->loop_duration;
+      cache->next_frame = find_frame (cache, offset % cache->loop_duration);
+    }
+  else
+    {
+      cache->loop_num = 0;
+      cache->next_frame = 0;
+    }
+
+  return TRUE;
+}
+
+void
+loop_cache_attach (LoopCache *cache,
+                   GstAppSrc *src)
+{
+  GstAppSrcCallbacks callbacks;
+
+  g_return_if_fail (cache->state == LOOP_CACHE_COMPLETE);
+
+  cache->next_frame = 0;
+  cache->loop_num = 0;
+
+  gst_app_src_set_caps (src, cache->caps);
+  gst_app_src_set_stream_type (src, GST_APP_STREAM_TYPE_SEEKABLE);
+  g_object_set (src, "format", GST_FORMAT_TIME, NULL);
+
+  memset (&callbacks, 0, sizeof (callbacks));
+  callbacks.need_data = need_data_cb;
+  callbacks.seek_data = seek_data_cb;
+  gst_app_src_set_callbacks (src, &callbacks, cache, NULL);
+}
+
+void
+loop_cache_free (LoopCache *cache)
+{
+  munmap (cache->data, cache->max_size);
+
+  if (cache->caps)
+    gst_caps_unref (cache->caps);
+
+  g_array_free (cache->frames, TRUE);
+
+  g_slice_free (LoopCache, cache);
+}
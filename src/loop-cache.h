@@ -0,0 +1,82 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _LOOP_CACHE_H
+#define _LOOP_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+
+/* Records the decoded frames of the first pass of a looping video
+ * into a memory-mapped file. Once the first loop is complete the
+ * frames can be played back forever from an appsrc without decoding
+ * them again. The buffers point straight into the mapping so they
+ * aren't copied before being uploaded */
+
+typedef struct _LoopCache LoopCache;
+
+/* max_size is the size in bytes of the largest clip to cache */
+LoopCache *
+loop_cache_new (size_t max_size,
+                GError **error);
+
+/* These are called from the streaming thread with the events and
+ * buffers on the sink pad. A flush restarts the recording and a
+ * change of caps part way through abandons it */
+void
+loop_cache_handle_event (LoopCache *cache,
+                         GstEvent *event);
+
+void
+loop_cache_record (LoopCache *cache,
+                   GstBuffer *buffer);
+
+/* Throws away the recording and starts again, for example because a
+ * different video has been loaded. This must only be called while
+ * the pipeline isn't streaming */
+void
+loop_cache_reset (LoopCache *cache);
+
+/* Called when the video has looped back to the start. Returns true
+ * if this completed the recording */
+bool
+loop_cache_finish (LoopCache *cache);
+
+bool
+loop_cache_is_complete (LoopCache *cache);
+
+/* Makes the appsrc play the cached frames in a loop. The timestamps
+ * carry on increasing through each loop and seeking to a time in that
+ * timeline starts from the frame showing at that time, so seeks and
+ * rate changes keep working while playing from the cache. The cache
+ * must be complete and must outlive the appsrc */
+void
+loop_cache_attach (LoopCache *cache,
+                   GstAppSrc *src);
+
+void
+loop_cache_free (LoopCache *cache);
+
+#endif /* _LOOP_CACHE_H */
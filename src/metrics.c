@@ -0,0 +1,211 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "metrics.h"
+#include "unix-service.h"
+
+#define METRICS_PREFIX "sprite_player_"
+
+struct _MetricsServer
+{
+  UnixService *service;
+
+  MetricsWriteFunc write_func;
+  void *user_data;
+};
+
+static gboolean
+incoming_cb (GSocketService *service,
+             GSocketConnection *connection,
+             GObject *source_object,
+             void *user_data)
+{
+  MetricsServer *server = user_data;
+  GOutputStream *stream;
+  GString *out = g_string_new (NULL);
+  GError *error = NULL;
+
+  server->write_func (out, server->user_data);
+
+  /* The snapshot is small so it is just written synchronously */
+  stream = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  if (!g_output_stream_write_all (stream,
+                                  out->str,
+                                  out->len,
+                                  NULL, /* bytes_written */
+                                  NULL, /* cancellable */
+                                  &error))
+    {
+      g_warning ("Error writing metrics: %s", error->message);
+      g_clear_error (&error);
+    }
+
+  g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+
+  g_string_free (out, TRUE);
+
+  return TRUE;
+}
+
+MetricsServer *
+metrics_server_new (const char *path,
+                    MetricsWriteFunc write_func,
+                    void *user_data,
+                    GError **error)
+{
+  MetricsServer *server = g_slice_new (MetricsServer);
+
+  server->write_func = write_func;
+  server->user_data = user_data;
+  server->service = unix_service_new (path, incoming_cb, server, error);
+
+  if (server->service == NULL)
+    {
+      g_slice_free (MetricsServer, server);
+      return NULL;
+    }
+
+  return server;
+}
+
+void
+metrics_server_free (MetricsServer *server)
+{
+  unix_service_free (server->service);
+
+  g_slice_free (MetricsServer, server);
+}
+
+static void
+add_header (GString *out,
+            const char *name,
+            const char *help,
+            const char *type)
+{
+  g_string_append_printf (out,
+                          "# HELP " METRICS_PREFIX "%s %s\n"
+                          "# TYPE " METRICS_PREFIX "%s %s\n",
+                          name, help,
+                          name, type);
+}
+
+void
+metrics_add_counter (GString *out,
+                     const char *name,
+                     const char *help,
+                     uint64_t value)
+{
+  add_header (out, name, help, "counter");
+  g_string_append_printf (out,
+                          METRICS_PREFIX "%s %" G_GUINT64_FORMAT "\n",
+                          name,
+                          (guint64) value);
+}
+
+void
+metrics_add_gauge (GString *out,
+                   const char *name,
+                   const char *help,
+                   double value)
+{
+  char buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  add_header (out, name, help, "gauge");
+  g_string_append_printf (out,
+                          METRICS_PREFIX "%s %s\n",
+                          name,
+                          g_ascii_dtostr (buf, sizeof (buf), value));
+}
+
+void
+metrics_add_info (GString *out,
+                  const char *name,
+                  const char *help,
+                  const char *label,
+                  const char *label_value)
+{
+  const char *p;
+
+  add_header (out, name, help, "gauge");
+  g_string_append_printf (out, METRICS_PREFIX "%s{%s=\"", name, label);
+
+  for (p = label_value; *p; p++)
+    {
+      if (*p == '\n')
+        {
+          g_string_append (out, "\\n");
+        }
+      else
+        {
+          if (*p == '"' || *p == '\\')
+            g_string_append_c (out, '\\');
+          g_string_append_c (out, *p);
+        }
+    }
+
+  g_string_append (out, "\"} 1\n");
+}
+
+void
+metrics_add_summary (GString *out,
+                     const char *name,
+                     const char *help,
+                     const Histogram *histogram)
+{
+  static const double quantiles[] = { 0.5, 0.9, 0.99 };
+  char buf[G_ASCII_DTOSTR_BUF_SIZE];
+  uint64_t count = histogram_get_count (histogram);
+  int i;
+
+  add_header (out, name, help, "summary");
+
+  for (i = 0; i < G_N_ELEMENTS (quantiles); i++)
+    {
+      double value =
+        histogram_get_percentile (histogram, quantiles[i] * 100.0) / 1e9;
+
+      g_string_append_printf (out,
+                              METRICS_PREFIX "%s{quantile=\"%g\"} ",
+                              name,
+                              quantiles[i]);
+      g_string_append (out, g_ascii_dtostr (buf, sizeof (buf), value));
+      g_string_append_c (out, '\n');
+    }
+
+  g_string_append_printf (out,
+                          METRICS_PREFIX "%s_sum %s\n",
+                          name,
+                          g_ascii_dtostr (buf,
+                                          sizeof (buf),
+                                          histogram_get_mean (histogram) *
+                                          count / 1e9));
+  g_string_append_printf (out,
+                          METRICS_PREFIX "%s_count %" G_GUINT64_FORMAT "\n",
+                          name,
+                          (guint64) count);
+}
@@ -0,0 +1,86 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdint.h>
+#include <glib.h>
+
+#include "histogram.h"
+
+/* Serves the player's metrics on a UNIX domain socket in the
+ * Prometheus text exposition format. Each connection gets a
+ * snapshot of the metrics and is then closed. The connections are
+ * handled from the thread-default main context of the thread that
+ * created the server */
+
+typedef struct _MetricsServer MetricsServer;
+
+/* Called to fill in the metrics for each connection */
+typedef void
+(* MetricsWriteFunc) (GString *out,
+                      void *user_data);
+
+MetricsServer *
+metrics_server_new (const char *path,
+                    MetricsWriteFunc write_func,
+                    void *user_data,
+                    GError **error);
+
+void
+metrics_server_free (MetricsServer *server);
+
+/* Helpers for the write function. The names are prefixed with
+ * sprite_player_ */
+
+void
+metrics_add_counter (GString *out,
+                     const char *name,
+                     const char *help,
+                     uint64_t value);
+
+void
+metrics_add_gauge (GString *out,
+                   const char *name,
+                   const char *help,
+                   double value);
+
+/* Adds a gauge with the value 1 and a single label. This is used to
+ * report a string such as the current effect name */
+void
+metrics_add_info (GString *out,
+                  const char *name,
+                  const char *help,
+                  const char *label,
+                  const char *label_value);
+
+/* Adds a summary with the median, 90th and 99th percentiles of a
+ * histogram of nanoseconds. The values are reported in seconds */
+void
+metrics_add_summary (GString *out,
+                     const char *name,
+                     const char *help,
+                     const Histogram *histogram);
+
+#endif /* _METRICS_H */
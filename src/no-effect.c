@@ -29,6 +29,7 @@
 #include <cogl-gst/cogl-gst.h>
 
 #include "effect.h"
+#include "texture-uploader.h"
 #include "borders.h"
 
 typedef struct _Data
@@ -49,6 +50,10 @@ paint (CoglFramebuffer *fb,
   CoglPipeline *pipeline =
     cogl_gst_video_sink_get_pipeline (data->sink);
 
+  /* The sink's pipeline already has its own frame but this is needed
+   * in case the frame came from the texture uploader */
+  texture_uploader_retarget_frame (data->sink, pipeline);
+
   borders_draw (data->borders, fb, video_output);
 
   cogl_framebuffer_draw_rectangle (fb,
@@ -97,4 +102,4 @@ fini (void *user_data)
   free (data);
 }
 
-EFFECT_DEFINE ("No effect", no_effect)
+EFFECT_DEFINE ("No effect", no_effect, 0)
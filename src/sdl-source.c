@@ -0,0 +1,139 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <SDL.h>
+#include <SDL_syswm.h>
+
+#include "sdl-source.h"
+
+/* How often to check for events in milliseconds if the window system
+ * connection can't be polled */
+#define FALLBACK_INTERVAL 16
+
+typedef struct
+{
+  GSource source;
+
+  GPollFD poll_fd;
+  bool have_fd;
+} SdlSource;
+
+static bool
+has_events (void)
+{
+  return SDL_HasEvents (SDL_FIRSTEVENT, SDL_LASTEVENT);
+}
+
+static gboolean
+sdl_source_prepare (GSource *source,
+                    int *timeout)
+{
+  SdlSource *sdl_source = (SdlSource *) source;
+
+  /* Xlib may have already read events from the connection while
+   * doing something else such as swapping the buffers. In that case
+   * the fd won't become readable so they need to be pumped here.
+   * Cogl also pushes its own events into the queue */
+  SDL_PumpEvents ();
+
+  if (has_events ())
+    {
+      *timeout = 0;
+      return TRUE;
+    }
+
+  *timeout = sdl_source->have_fd ? -1 : FALLBACK_INTERVAL;
+
+  return FALSE;
+}
+
+static gboolean
+sdl_source_check (GSource *source)
+{
+  SdlSource *sdl_source = (SdlSource *) source;
+
+  if (!sdl_source->have_fd || sdl_source->poll_fd.revents)
+    SDL_PumpEvents ();
+
+  return has_events ();
+}
+
+static gboolean
+sdl_source_dispatch (GSource *source,
+                     GSourceFunc callback,
+                     void *user_data)
+{
+  if (callback == NULL)
+    return G_SOURCE_CONTINUE;
+
+  return callback (user_data);
+}
+
+static GSourceFuncs
+sdl_source_funcs =
+  {
+    sdl_source_prepare,
+    sdl_source_check,
+    sdl_source_dispatch,
+    NULL /* finalize */
+  };
+
+static int
+get_connection_fd (CoglOnscreen *onscreen)
+{
+  SDL_Window *window = cogl_sdl_onscreen_get_window (onscreen);
+  SDL_SysWMinfo info;
+
+  SDL_VERSION (&info.version);
+
+  if (!SDL_GetWindowWMInfo (window, &info))
+    return -1;
+
+#ifdef SDL_VIDEO_DRIVER_X11
+  if (info.subsystem == SDL_SYSWM_X11)
+    return ConnectionNumber (info.info.x11.display);
+#endif
+
+  return -1;
+}
+
+GSource *
+sdl_source_new (CoglOnscreen *onscreen)
+{
+  GSource *source = g_source_new (&sdl_source_funcs, sizeof (SdlSource));
+  SdlSource *sdl_source = (SdlSource *) source;
+  int fd = get_connection_fd (onscreen);
+
+  if (fd != -1)
+    {
+      sdl_source->poll_fd.fd = fd;
+      sdl_source->poll_fd.events = G_IO_IN | G_IO_HUP | G_IO_ERR;
+      sdl_source->have_fd = true;
+      g_source_add_poll (source, &sdl_source->poll_fd);
+    }
+
+  return source;
+}
@@ -0,0 +1,40 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _SDL_SOURCE_H
+#define _SDL_SOURCE_H
+
+#include <glib.h>
+#include <cogl/cogl.h>
+
+/* A GSource that is dispatched whenever SDL has pending events. It
+ * polls the connection to the window system so the main loop only
+ * wakes up when something has actually happened. If the connection
+ * can't be found, for example on Wayland, it falls back to checking
+ * for events periodically. Set the callback with
+ * g_source_set_callback() and drain the events with SDL_PollEvent() */
+
+GSource *
+sdl_source_new (CoglOnscreen *onscreen);
+
+#endif /* _SDL_SOURCE_H */
@@ -0,0 +1,174 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "fireworks-sim.h"
+#include "stars-sim.h"
+
+/* Micro-benchmark for the CPU side of the effects. The simulations
+ * are stepped with a fixed time step so the results don't depend on
+ * a GL context or a video pipeline */
+
+#define TIME_STEP (1.0f / 60.0f)
+
+/* Each measurement processes roughly this many particles in total so
+ * that the small counts run for long enough to be timed */
+#define PARTICLES_PER_MEASUREMENT (16 * 1024 * 1024)
+
+#define MIN_PARTICLES 1024
+#define MAX_PARTICLES (1024 * 1024)
+
+/* The video size is only used to pick the texture coordinates of
+ * the stars */
+#define VIDEO_WIDTH 1920.0f
+#define VIDEO_HEIGHT 1080.0f
+
+#define SEED 42
+
+static int
+get_n_steps (int n_particles)
+{
+  int n_steps = PARTICLES_PER_MEASUREMENT / n_particles;
+
+  return MAX (n_steps, 8);
+}
+
+static void
+report (const char *name,
+        int n_particles,
+        int64_t elapsed_us,
+        int64_t n_operations,
+        const char *unit)
+{
+  g_print ("%-18s %8i %10.2f ns/%s\n",
+           name,
+           n_particles,
+           elapsed_us * 1000.0 / n_operations,
+           unit);
+}
+
+static void
+bench_fireworks (int n_sparks)
+{
+  /* Keep the same ratio of sparks to fireworks as the effect */
+  FireworksSim *sim = fireworks_sim_new (MAX (n_sparks / 32, 1),
+                                         n_sparks,
+                                         SEED);
+  int n_steps = get_n_steps (n_sparks);
+  int64_t start_time;
+  int i;
+
+  /* Warm up so that all of the sparks are in use */
+  for (i = 0; i < 32; i++)
+    fireworks_sim_update (sim, i * TIME_STEP);
+
+  start_time = g_get_monotonic_time ();
+
+  for (i = 0; i < n_steps; i++)
+    fireworks_sim_update (sim, (i + 32) * TIME_STEP);
+
+  report ("fireworks-update",
+          n_sparks,
+          g_get_monotonic_time () - start_time,
+          (int64_t) n_steps * n_sparks,
+          "particle");
+
+  fireworks_sim_free (sim);
+}
+
+static void
+bench_stars (int n_stars)
+{
+  StarsSim *sim = stars_sim_new (SEED);
+  int n_steps = get_n_steps (n_stars);
+  int n_inserts = MAX (MIN (n_steps, 256), 16);
+  int64_t start_time;
+  double elapsed = 0.0;
+  int i;
+
+  stars_sim_add_stars (sim, n_stars, 0.0f, VIDEO_WIDTH, VIDEO_HEIGHT);
+
+  /* Walk the list without changing the number of stars. The time is
+   * kept within the first tenth of a second so that no stars fall off
+   * the screen and none are added after the first update */
+  start_time = g_get_monotonic_time ();
+
+  for (i = 0; i < n_steps; i++)
+    {
+      elapsed = (i % 64) * (0.1f / 64.0f);
+      stars_sim_update (sim, elapsed, VIDEO_WIDTH, VIDEO_HEIGHT);
+    }
+
+  report ("stars-update",
+          n_stars,
+          g_get_monotonic_time () - start_time,
+          (int64_t) n_steps * n_stars,
+          "particle");
+
+  /* Sorted insertion into a list of n_stars */
+  start_time = g_get_monotonic_time ();
+
+  for (i = 0; i < n_inserts; i++)
+    stars_sim_add_star (sim, elapsed, VIDEO_WIDTH, VIDEO_HEIGHT);
+
+  report ("stars-insert",
+          n_stars,
+          g_get_monotonic_time () - start_time,
+          n_inserts,
+          "insert");
+
+  /* Move far enough into the future that every star falls off the
+   * screen and gets freed */
+  n_stars = g_list_length (stars_sim_get_stars (sim));
+  start_time = g_get_monotonic_time ();
+
+  stars_sim_update (sim, 1000.0f, VIDEO_WIDTH, VIDEO_HEIGHT);
+
+  report ("stars-free",
+          n_stars,
+          g_get_monotonic_time () - start_time,
+          n_stars,
+          "particle");
+
+  stars_sim_free (sim);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  int n_particles;
+
+  for (n_particles = MIN_PARTICLES;
+       n_particles <= MAX_PARTICLES;
+       n_particles *= 4)
+    {
+      bench_fireworks (n_particles);
+      bench_stars (n_particles);
+    }
+
+  return 0;
+}
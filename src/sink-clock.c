@@ -0,0 +1,204 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <gst/base/gstbasesink.h>
+
+#include "sink-clock.h"
+
+struct _SinkClock
+{
+  GstElement *sink;
+  GstClockTime lead_time;
+
+  /* Only used by the streaming thread */
+  GstSegment segment;
+
+  /* The wait of the streaming thread so that it can be interrupted
+   * by a flush. Protected by the mutex */
+  GMutex mutex;
+  GstClockID clock_id;
+  bool flushing;
+  bool stopped;
+};
+
+SinkClock *
+sink_clock_new (GstElement *sink,
+                GstClockTime lead_time)
+{
+  SinkClock *sink_clock = g_slice_new0 (SinkClock);
+
+  sink_clock->sink = gst_object_ref (sink);
+  sink_clock->lead_time = lead_time;
+
+  gst_segment_init (&sink_clock->segment, GST_FORMAT_TIME);
+  g_mutex_init (&sink_clock->mutex);
+
+  return sink_clock;
+}
+
+static void
+set_flushing (SinkClock *sink_clock,
+              bool flushing)
+{
+  g_mutex_lock (&sink_clock->mutex);
+  sink_clock->flushing = flushing;
+  if (flushing && sink_clock->clock_id)
+    gst_clock_id_unschedule (sink_clock->clock_id);
+  g_mutex_unlock (&sink_clock->mutex);
+}
+
+void
+sink_clock_handle_event (SinkClock *sink_clock,
+                         GstEvent *event)
+{
+  switch (GST_EVENT_TYPE (event))
+    {
+    case GST_EVENT_SEGMENT:
+      gst_event_copy_segment (event, &sink_clock->segment);
+      break;
+
+    case GST_EVENT_FLUSH_START:
+      /* This comes from the thread doing the flush */
+      set_flushing (sink_clock, true);
+      break;
+
+    case GST_EVENT_FLUSH_STOP:
+      set_flushing (sink_clock, false);
+      break;
+
+    default:
+      break;
+    }
+}
+
+/* The sink has to get the buffers while it isn't playing so that it
+ * can preroll and step */
+static bool
+sink_is_playing (SinkClock *sink_clock)
+{
+  GstElement *sink = sink_clock->sink;
+  bool playing;
+
+  GST_OBJECT_LOCK (sink);
+  playing = (GST_STATE (sink) == GST_STATE_PLAYING &&
+             GST_STATE_TARGET (sink) == GST_STATE_PLAYING);
+  GST_OBJECT_UNLOCK (sink);
+
+  return playing;
+}
+
+static bool
+wait_for_time (SinkClock *sink_clock,
+               GstClock *clock,
+               GstClockTime time)
+{
+  GstClockReturn ret;
+
+  g_mutex_lock (&sink_clock->mutex);
+
+  if (sink_clock->stopped || sink_clock->flushing)
+    {
+      g_mutex_unlock (&sink_clock->mutex);
+      return false;
+    }
+
+  sink_clock->clock_id = gst_clock_new_single_shot_id (clock, time);
+
+  g_mutex_unlock (&sink_clock->mutex);
+
+  ret = gst_clock_id_wait (sink_clock->clock_id, NULL /* jitter */);
+
+  g_mutex_lock (&sink_clock->mutex);
+  gst_clock_id_unref (sink_clock->clock_id);
+  sink_clock->clock_id = NULL;
+  g_mutex_unlock (&sink_clock->mutex);
+
+  return ret != GST_CLOCK_UNSCHEDULED;
+}
+
+bool
+sink_clock_wait (SinkClock *sink_clock,
+                 GstBuffer *buffer)
+{
+  GstBaseSink *sink = GST_BASE_SINK (sink_clock->sink);
+  GstClockTimeDiff offset;
+  GstClockTime running_time, time;
+  GstClock *clock;
+  bool ret;
+
+  if (!sink_is_playing (sink_clock))
+    return false;
+
+  if (!gst_base_sink_get_sync (sink))
+    return true;
+
+  running_time = gst_segment_to_running_time (&sink_clock->segment,
+                                              GST_FORMAT_TIME,
+                                              GST_BUFFER_PTS (buffer));
+
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return true;
+
+  clock = gst_element_get_clock (sink_clock->sink);
+
+  if (clock == NULL)
+    return true;
+
+  time = (gst_element_get_base_time (sink_clock->sink) +
+          running_time +
+          gst_base_sink_get_latency (sink));
+  offset = gst_base_sink_get_ts_offset (sink) - sink_clock->lead_time;
+
+  if (offset < 0 && -offset > time)
+    time = 0;
+  else
+    time += offset;
+
+  ret = wait_for_time (sink_clock, clock, time);
+
+  gst_object_unref (clock);
+
+  /* The pipeline may have been paused in the meantime */
+  return ret && sink_is_playing (sink_clock);
+}
+
+void
+sink_clock_stop (SinkClock *sink_clock)
+{
+  g_mutex_lock (&sink_clock->mutex);
+  sink_clock->stopped = true;
+  if (sink_clock->clock_id)
+    gst_clock_id_unschedule (sink_clock->clock_id);
+  g_mutex_unlock (&sink_clock->mutex);
+}
+
+void
+sink_clock_free (SinkClock *sink_clock)
+{
+  g_mutex_clear (&sink_clock->mutex);
+  gst_object_unref (sink_clock->sink);
+
+  g_slice_free (SinkClock, sink_clock);
+}
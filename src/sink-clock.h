@@ -0,0 +1,65 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _SINK_CLOCK_H
+#define _SINK_CLOCK_H
+
+#include <stdbool.h>
+#include <gst/gst.h>
+
+/* Waits on the clock on behalf of a base sink for the buffers that
+ * are taken from its sink pad before they reach it. That way the
+ * decoder is still held back by the clock the same way as when the
+ * sink gets every buffer */
+
+typedef struct _SinkClock SinkClock;
+
+/* The waits end lead_time before the sink would have rendered each
+ * buffer */
+SinkClock *
+sink_clock_new (GstElement *sink,
+                GstClockTime lead_time);
+
+/* Called for each event on the sink pad. A flush interrupts the
+ * current wait */
+void
+sink_clock_handle_event (SinkClock *sink_clock,
+                         GstEvent *event);
+
+/* Called from the streaming thread. Returns true once it is time for
+ * the buffer, or straight away if the sink isn't synchronised to the
+ * clock. Returns false if the sink isn't playing or the wait was
+ * interrupted, in which case the buffer should be given to the sink
+ * so that it can preroll or throw it away */
+bool
+sink_clock_wait (SinkClock *sink_clock,
+                 GstBuffer *buffer);
+
+/* Unblocks the streaming thread and makes any later waits fail */
+void
+sink_clock_stop (SinkClock *sink_clock);
+
+void
+sink_clock_free (SinkClock *sink_clock);
+
+#endif /* _SINK_CLOCK_H */
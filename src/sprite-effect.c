@@ -29,13 +29,12 @@
 #include <cogl-gst/cogl-gst.h>
 
 #include "effect.h"
+#include "texture-uploader.h"
+#include "fireworks-sim.h"
 
 #define N_FIREWORKS 32
-/* Units per second per second */
-#define GRAVITY -1.5f
 
 #define N_SPARKS (N_FIREWORKS * 32) /* Must be a power of two */
-#define TIME_PER_SPARK 0.01f /* in seconds */
 
 #define TEXTURE_SIZE 32
 
@@ -44,36 +43,14 @@ typedef struct
   uint8_t red, green, blue, alpha;
 } Color;
 
-typedef struct
-{
-  float size;
-  float x, y;
-  float start_x, start_y;
-
-  /* Velocities are in units per second */
-  float initial_x_velocity;
-  float initial_y_velocity;
-
-  GTimer *timer;
-} Firework;
-
-typedef struct
-{
-  float x, y;
-  float fade;
-} Spark;
-
 typedef struct _Data
 {
   CoglContext *context;
 
   CoglGstVideoSink *sink;
 
-  Firework fireworks[N_FIREWORKS];
-
-  int next_spark_num;
-  Spark sparks[N_SPARKS];
-  GTimer *last_spark_time;
+  FireworksSim *sim;
+  GTimer *timer;
 
   float last_output_width;
   float last_output_height;
@@ -133,14 +110,10 @@ paint (CoglFramebuffer *fb,
        void *user_data)
 {
   Data *data = user_data;
-  int i;
-  float diff_time;
   CoglPipeline *pipeline;
 
-  pipeline = cogl_pipeline_copy (data->pipeline);
-  cogl_gst_video_sink_attach_frame (data->sink, pipeline);
-  cogl_object_unref (data->pipeline);
-  data->pipeline = pipeline;
+  pipeline = data->pipeline;
+  texture_uploader_retarget_frame (data->sink, pipeline);
 
   if (data->last_output_width != video_output->width ||
       data->last_output_height != video_output->height)
@@ -167,74 +140,12 @@ paint (CoglFramebuffer *fb,
       data->last_output_height = video_output->height;
     }
 
-  /* Update all of the firework's positions */
-  for (i = 0; i < N_FIREWORKS; i++)
-    {
-      Firework *firework = data->fireworks + i;
-
-      if ((fabsf (firework->x - firework->start_x) > 2.0f) ||
-          firework->y < -1.0f)
-        {
-          firework->size = g_random_double_range (0.001f, 0.1f);
-          firework->start_x = 1.0f + firework->size;
-          firework->start_y = -1.0f;
-          firework->initial_x_velocity = g_random_double_range (-0.1f, -2.0f);
-          firework->initial_y_velocity = g_random_double_range (0.1f, 4.0f);
-          g_timer_reset (firework->timer);
-
-          /* Fire some of the fireworks from the other side */
-          if (g_random_boolean ())
-            {
-              firework->start_x = -firework->start_x;
-              firework->initial_x_velocity = -firework->initial_x_velocity;
-            }
-        }
-
-      diff_time = g_timer_elapsed (firework->timer, NULL);
-
-      firework->x = (firework->start_x +
-                     firework->initial_x_velocity * diff_time);
-
-      firework->y = ((firework->initial_y_velocity * diff_time +
-                      0.5f * GRAVITY * diff_time * diff_time) +
-                     firework->start_y);
-    }
-
-  diff_time = g_timer_elapsed (data->last_spark_time, NULL);
-  if (diff_time < 0.0f || diff_time >= TIME_PER_SPARK)
-    {
-      /* Add a new spark for each firework, overwriting the oldest ones */
-      for (i = 0; i < N_FIREWORKS; i++)
-        {
-          Spark *spark = data->sparks + data->next_spark_num;
-          Firework *firework = data->fireworks + i;
-
-          spark->x = (firework->x +
-                      g_random_double_range (-firework->size / 2.0f,
-                                             firework->size / 2.0f));
-          spark->y = (firework->y +
-                      g_random_double_range (-firework->size / 2.0f,
-                                             firework->size / 2.0f));
-
-          data->next_spark_num = (data->next_spark_num + 1) & (N_SPARKS - 1);
-        }
-
-      /* Update the fade of each spark */
-      for (i = 0; i < N_SPARKS; i++)
-        {
-          /* First spark is the oldest */
-          Spark *spark = data->sparks + ((data->next_spark_num + i)
-                                         & (N_SPARKS - 1));
-          spark->fade = i / (N_SPARKS - 1.0f);
-        }
-
-      g_timer_reset (data->last_spark_time);
-    }
+  fireworks_sim_update (data->sim, g_timer_elapsed (data->timer, NULL));
 
   cogl_buffer_set_data (COGL_BUFFER (data->attribute_buffer),
                         0, /* offset */
-                        data->sparks,
-                        sizeof (data->sparks),
+                        fireworks_sim_get_sparks (data->sim),
+                        sizeof (Spark) * N_SPARKS,
                         NULL /* error */);
 
   cogl_framebuffer_clear4f (fb, COGL_BUFFER_BIT_COLOR, 0, 0, 0, 1);
@@ -275,7 +186,7 @@ create_primitive (Data *data)
 
   data->attribute_buffer =
     cogl_attribute_buffer_new_with_size (data->context,
-                                         sizeof (data->sparks));
+                                         sizeof (Spark) * N_SPARKS);
   cogl_buffer_set_update_hint (COGL_BUFFER (data->attribute_buffer),
                                COGL_BUFFER_UPDATE_HINT_DYNAMIC);
 
@@ -363,24 +274,9 @@ init (CoglContext *context,
 {
   Data *data = g_new0 (Data, 1);
   CoglContext *ctx;
-  int i;
-
-  for (i = 0; i < N_FIREWORKS; i++)
-    {
-      data->fireworks[i].x = -FLT_MAX;
-      data->fireworks[i].y = FLT_MAX;
-      data->fireworks[i].size = 0.0f;
-      data->fireworks[i].timer = g_timer_new ();
-    }
 
-  for (i = 0; i < N_SPARKS; i++)
-    {
-      data->sparks[i].x = 2.0f;
-      data->sparks[i].y = 2.0f;
-    }
-
-  data->last_spark_time = g_timer_new ();
-  data->next_spark_num = 0;
+  data->sim = fireworks_sim_new (N_FIREWORKS, N_SPARKS, g_random_int ());
+  data->timer = g_timer_new ();
 
   data->context = ctx = cogl_object_ref (context);
   data->sink = g_object_ref (sink);
@@ -388,9 +284,6 @@ init (CoglContext *context,
   create_pipeline (data);
   create_primitive (data);
 
-  cogl_gst_video_sink_set_default_sample (data->sink, FALSE);
-  cogl_gst_video_sink_set_first_layer (data->sink, 1);
-
   return data;
 }
 
@@ -405,6 +298,9 @@ fini (void *user_data)
   cogl_object_unref (data->attribute_buffer);
   cogl_object_unref (data->primitive);
 
+  fireworks_sim_free (data->sim);
+  g_timer_destroy (data->timer);
+
   g_object_unref (data->sink);
 
   cogl_object_unref (data->context);
@@ -412,4 +308,7 @@ fini (void *user_data)
   free (data);
 }
 
-EFFECT_DEFINE ("Point sprites", sprite_effect)
+EFFECT_DEFINE ("Point sprites", sprite_effect,
+               EFFECT_FLAG_ANIMATED |
+               EFFECT_FLAG_CUSTOM_SAMPLE |
+               EFFECT_FLAG_RESERVE_LAYER)
@@ -24,39 +24,278 @@
 #include "config.h"
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include <cogl/cogl.h>
 #include <cogl-gst/cogl-gst.h>
+#include <gst/base/gstbasesink.h>
+#include <gst/video/video.h>
 #include <gio/gio.h>
 #include <SDL.h>
 
 #include "effects.h"
+#include "stats.h"
+#include "gpu-timer.h"
+#include "trace.h"
+#include "metrics.h"
+#include "frame-scheduler.h"
+#include "frame-queue.h"
+#include "texture-uploader.h"
+#include "allocation.h"
+#include "duplicate-detector.h"
+#include "sink-clock.h"
+#include "loop-cache.h"
+#include "frame-history.h"
+#include "image-sequence.h"
+#include "sdl-source.h"
+#include "channel.h"
+#include "control-server.h"
+#include "contact-sheet.h"
+
+/* Number of swaps that can be waiting for their COMPLETE event */
+#define MAX_PENDING_SWAPS 4
+
+/* From GstPlayFlags, which isn't in a public header */
+#define PLAY_FLAG_BUFFERING (1 << 8)
+
+typedef struct
+{
+  int64_t frame_counter;
+  int64_t capture_time;
+} PendingSwap;
 
 typedef struct _Data
 {
   CoglContext *context;
   CoglFramebuffer *fb;
   CoglGstVideoSink *sink;
+  GstElement *pipeline;
   GstElement *playbin;
   int onscreen_width;
   int onscreen_height;
   CoglGstRectangle video_output;
-  bool draw_ready;
-  bool frame_ready;
+  FrameScheduler *scheduler;
   GMainLoop *main_loop;
 
+  /* Frames that have reached the sink but haven't been handed over
+   * yet. current_frame is the one waiting to be painted */
+  FrameQueue *frame_queue;
+  QueuedFrame current_frame;
+
+  /* Only created with --async-upload */
+  TextureUploader *uploader;
+
+  DuplicateDetector *duplicate_detector;
+  /* Waits for the duplicate frames before they are dropped */
+  SinkClock *sink_clock;
+
+  /* Only created with --loop-cache. Once the first loop has been
+   * recorded the playbin is switched over to play from it */
+  LoopCache *loop_cache;
+
+  /* Textures of the last few frames for stepping backwards. This and
+   * the time of the last seek are only used by the render thread */
+  FrameHistory *frame_history;
+  int64_t seek_start_time;
+
+  /* Only created with --images */
+  ImageSequence *image_sequence;
+
+  /* Index into opt_playlist of the item being decoded. This is only
+   * used by the streaming thread */
+  int playlist_pos;
+
+  /* The playback rate is 2^rate_num. This and paused are only used
+   * by the control thread */
+  int rate_num;
+  bool paused;
+
+  /* Set on the control thread once the looping segment seek has been
+   * tried */
+  bool segment_seek_done;
+  /* Set when a seek back to the start has been made or the playlist
+   * has moved on so that the next segment on the sink pad is a loop
+   * boundary */
+  int loop_seek_pending;
+  /* These are only used by the streaming thread */
+  int64_t last_buffer_arrival;
+  bool measure_loop_gap;
+
+  /* The bus and the commands from the input are handled on a
+   * separate control thread so that they can't delay painting */
+  GMainContext *control_context;
+  GMainLoop *control_loop;
+  GThread *control_thread;
+  Channel *to_control;
+  Channel *to_render;
+  /* Messages from the streaming thread to the render thread */
+  Channel *from_streaming;
+
+  /* Only created with --control-socket. The request waiting for its
+   * first frame and the requested effect are used by the control
+   * thread */
+  ControlServer *control_server;
+  ControlRequest *pending_request;
+  GSource *pending_timeout;
+  /* Increased for each command that waits for a frame so that a late
+   * reply for a command that timed out isn't taken for the next
+   * one */
+  int command_serial;
+  int requested_effect_num;
+  /* Set on the render thread while it is waiting for the first frame
+   * painted after a command. Only frames that reached the sink after
+   * the command count if command_needs_new_frame is set */
+  int64_t command_start_time;
+  bool command_needs_new_frame;
+  int command_tag;
+
+  /* In headless mode fb is an offscreen framebuffer and painting
+   * isn't throttled to the display */
+  bool headless;
+  int dump_frame_num;
+
+  bool swap_interval_applied;
+
+  /* Capture times of the frames in each swap with --live. They are
+   * indexed by the frame counter modulo MAX_PENDING_SWAPS */
+  PendingSwap pending_swaps[MAX_PENDING_SWAPS];
+  int64_t ts_offset;
+
+  Stats stats;
+  GpuTimer *gpu_timer;
+
+  /* Frame rates over the last second for the metrics */
+  int64_t last_rate_time;
+  int last_frames_painted;
+  int last_frames_decoded;
+  double painted_fps;
+  double decoded_fps;
+
   const Effect *current_effect;
+  int current_effect_num;
   void *effect_data;
+
+  /* With --prewarm-effects every effect is initialised at startup
+   * and then their shaders are compiled one at a time from an idle
+   * source */
+  void *prewarmed_data[N_EFFECTS];
+  CoglFramebuffer *warm_fb;
+  int n_warm_effects;
+  guint warm_source;
+  /* When the last effect switch was requested in nanoseconds or 0 if
+   * the next paint isn't the first one after a switch */
+  int64_t effect_switch_time;
 } Data;
 
 typedef enum
 {
   VIDEO_TYPE_NONE,
-  VIDEO_TYPE_FILE
+  VIDEO_TYPE_FILE,
+  VIDEO_TYPE_PLAYLIST,
+  VIDEO_TYPE_IMAGES,
+  VIDEO_TYPE_TEST
 } VideoType;
 
+typedef enum
+{
+  /* Sent to the control thread. The value is the SDL keysym */
+  MESSAGE_KEY_PRESS,
+  /* Sent to the render thread. The value is the effect number */
+  MESSAGE_SET_EFFECT,
+  /* Sent to the render thread just before MESSAGE_SET_EFFECT. The
+   * value is when the switch was requested in nanoseconds */
+  MESSAGE_EFFECT_SWITCH_STARTED,
+  /* Sent from the streaming thread when a frame was dropped because
+   * it was the same as the last one. The value is the target time */
+  MESSAGE_DUPLICATE_FRAME,
+  /* Sent from the streaming thread for the first frame after looping
+   * back to the start or moving on to the next playlist item. The
+   * value is the time in nanoseconds since the last frame before */
+  MESSAGE_LOOP,
+  /* Sent to the render thread after a command from the control
+   * socket. The value is when the command was received in
+   * nanoseconds or 0 to stop waiting. WAIT_FOR_PAINT is reported on
+   * the next paint and WAIT_FOR_FRAME on the first paint of a frame
+   * that reached the sink after the command. The tag is the command's
+   * serial number */
+  MESSAGE_WAIT_FOR_PAINT,
+  MESSAGE_WAIT_FOR_FRAME,
+  /* Sent to the control thread when the first frame after a command
+   * has been painted. The value is the latency in nanoseconds and the
+   * tag is the serial number from the WAIT message */
+  MESSAGE_COMMAND_DONE,
+  /* Sent to the render thread after a seek to change the playback
+   * rate. The value is the new rate_num */
+  MESSAGE_SET_RATE,
+  /* Sent to the render thread after a flushing seek. The value is
+   * when the seek was made in nanoseconds or 0 if the latency
+   * shouldn't be measured */
+  MESSAGE_SEEK_STARTED,
+  /* Sent to the render thread to step one frame while paused. The
+   * value is 1 to step forwards or -1 to step backwards */
+  MESSAGE_STEP,
+  /* Sent to the control thread when a step forwards needs a new frame
+   * from the pipeline */
+  MESSAGE_STEP_PIPELINE
+} MessageType;
+
+/* SCHED_FIFO priority of the render thread with --realtime. This is
+ * low enough to stay below the kernel's own threaded interrupts */
+#define REALTIME_PRIORITY 10
+
+/* Size of the framebuffer that the effects are painted into to
+ * compile their shaders with --prewarm-effects */
+#define WARM_FB_SIZE 16
+
+/* How far the left and right keys seek */
+#define SEEK_STEP_SECONDS 5
+
+/* How long a control command waits for its first frame before giving
+ * up, for example when the pipeline is paused or stalls */
+#define COMMAND_TIMEOUT_SECONDS 10
+
 static VideoType opt_video_type = VIDEO_TYPE_NONE;
 static const char *opt_video_file = NULL;
+/* NULL-terminated array of URIs loaded from the playlist file */
+static char **opt_playlist = NULL;
+static gboolean opt_headless = FALSE;
+static int opt_width = 800;
+static int opt_height = 600;
+static const char *opt_dump_dir = NULL;
+static int opt_test_width, opt_test_height;
+static int opt_frame_rate = 30;
+static const char *opt_effect = NULL;
+static int opt_frames = 0;
+static gboolean opt_decode_only = FALSE;
+static gboolean opt_uncapped = FALSE;
+static gboolean opt_json = FALSE;
+static gboolean opt_list_effects = FALSE;
+static gboolean opt_gpu_timing = FALSE;
+static const char *opt_trace_file = NULL;
+static const char *opt_metrics_socket = NULL;
+static int opt_swap_interval = 1;
+static gboolean opt_realtime = FALSE;
+static int opt_render_cpu = -1;
+static int opt_max_queued_frames = 4;
+static gboolean opt_async_upload = FALSE;
+static gboolean opt_sink_pool = TRUE;
+static gboolean opt_skip_duplicates = FALSE;
+static gboolean opt_gapless_loop = TRUE;
+static int opt_loop_cache = 0;
+static gboolean opt_live = FALSE;
+static gboolean opt_prewarm_effects = FALSE;
+static gboolean opt_shader_cache = TRUE;
+static const char *opt_shader_cache_dir = NULL;
+static int opt_frame_history = 0;
+static int opt_latency = -1;
+static const char *opt_control_socket = NULL;
+static int opt_contact_sheet_columns = 0, opt_contact_sheet_rows = 0;
+static const char *opt_contact_sheet_output = "contact-sheet.png";
 
 static gboolean
 set_video_type (VideoType type,
@@ -90,284 +329,2396 @@ opt_filename_cb (const char *option_name,
   return TRUE;
 }
 
-static GOptionEntry
-main_options[] =
-  {
-    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_CALLBACK, &opt_filename_cb,
-      "File or URL to play", "FILE" },
-    { NULL, 0, 0, 0, NULL, NULL, NULL }
-  };
+static char *
+get_uri (const char *input)
+{
+  GFile *file;
+  char *uri;
+
+  if (!g_file_test (input, G_FILE_TEST_EXISTS))
+    return g_strdup (input);
+
+  file = g_file_new_for_path (input);
+  uri = g_file_get_uri (file);
+  g_object_unref (file);
+
+  return uri;
+}
 
 static gboolean
-bus_watch (GstBus *bus,
-           GstMessage *msg,
-           void *user_data)
+opt_playlist_cb (const char *option_name,
+                 const char *value,
+                 void *data,
+                 GError **error)
 {
-  Data *data = (Data *) user_data;
+  GPtrArray *uris;
+  char *contents;
+  char **lines;
+  int i;
 
-  switch (GST_MESSAGE_TYPE (msg))
+  if (!set_video_type (VIDEO_TYPE_PLAYLIST, error))
+    return FALSE;
+
+  if (!g_file_get_contents (value, &contents, NULL, error))
+    return FALSE;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  uris = g_ptr_array_new ();
+
+  /* One file or URL per line. Blank lines and lines starting with
+   * '#' are ignored */
+  for (i = 0; lines[i]; i++)
     {
-      case GST_MESSAGE_EOS:
-        {
-          gst_element_seek_simple (GST_ELEMENT (data->playbin),
-                                   GST_FORMAT_TIME,
-                                   GST_SEEK_FLAG_FLUSH,
-                                   0);
-          break;
-        }
-      case GST_MESSAGE_ERROR:
-        {
-          char *debug;
-          GError *error = NULL;
+      char *line = g_strstrip (lines[i]);
 
-          gst_message_parse_error (msg, &error, &debug);
-          g_free (debug);
+      if (*line && *line != '#')
+        g_ptr_array_add (uris, get_uri (line));
+    }
 
-          if (error != NULL)
-            {
-              g_error ("Playback error: %s\n", error->message);
-              g_error_free (error);
-            }
-          g_main_loop_quit (data->main_loop);
-          break;
-        }
-      default:
-        break;
+  g_strfreev (lines);
+
+  if (uris->len == 0)
+    {
+      g_ptr_array_free (uris, TRUE);
+      g_set_error (error,
+                   G_OPTION_ERROR,
+                   G_OPTION_ERROR_BAD_VALUE,
+                   "The playlist '%s' is empty",
+                   value);
+      return FALSE;
     }
 
+  g_ptr_array_add (uris, NULL);
+  opt_playlist = (char **) g_ptr_array_free (uris, FALSE);
+  opt_video_file = g_strdup (value);
+
   return TRUE;
 }
 
-static void
-paint (Data *data)
+static gboolean
+opt_images_cb (const char *option_name,
+               const char *value,
+               void *data,
+               GError **error)
 {
-  data->current_effect->paint (data->fb,
-                               &data->video_output,
-                               data->effect_data);
+  if (!set_video_type (VIDEO_TYPE_IMAGES, error))
+    return FALSE;
 
-  cogl_onscreen_swap_buffers (COGL_ONSCREEN (data->fb));
-}
+  opt_video_file = g_strdup (value);
 
-static void
-check_draw (Data *data)
-{
-  /* The frame is only drawn once we know that a new buffer is ready
-   * from GStreamer and that Cogl is ready to accept some new
-   * rendering */
-  if (data->draw_ready && data->frame_ready)
-    {
-      paint (data);
-      data->draw_ready = FALSE;
-      data->frame_ready = FALSE;
-    }
+  return TRUE;
 }
 
-static void
-frame_callback (CoglOnscreen *onscreen,
-                CoglFrameEvent event,
-                CoglFrameInfo *info,
-                void *user_data)
+static gboolean
+parse_size (const char *value,
+            int *width_out,
+            int *height_out,
+            GError **error)
 {
-  Data *data = user_data;
+  int width, height;
+  char trailing;
 
-  if (event == COGL_FRAME_EVENT_SYNC)
+  if (sscanf (value, "%dx%d%c", &width, &height, &trailing) != 2 ||
+      width <= 0 || height <= 0)
     {
-      data->draw_ready = TRUE;
-      check_draw (data);
+      g_set_error (error,
+                   G_OPTION_ERROR,
+                   G_OPTION_ERROR_BAD_VALUE,
+                   "Invalid size '%s'",
+                   value);
+      return FALSE;
     }
+
+  *width_out = width;
+  *height_out = height;
+
+  return TRUE;
 }
 
-static void
-new_frame_cb (CoglGstVideoSink *sink,
-              Data *data)
+static gboolean
+opt_size_cb (const char *option_name,
+             const char *value,
+             void *data,
+             GError **error)
 {
-  data->frame_ready = TRUE;
-  check_draw (data);
+  return parse_size (value, &opt_width, &opt_height, error);
 }
 
-static void
-update_video_output (Data *data)
+static gboolean
+opt_test_source_cb (const char *option_name,
+                    const char *value,
+                    void *data,
+                    GError **error)
 {
-  CoglGstRectangle available;
-
-  available.x = 0;
-  available.y = 0;
-  available.width = data->onscreen_width;
-  available.height = data->onscreen_height;
+  if (!set_video_type (VIDEO_TYPE_TEST, error))
+    return FALSE;
 
-  cogl_gst_video_sink_fit_size (data->sink,
-                                &available,
-                                &data->video_output);
+  return parse_size (value, &opt_test_width, &opt_test_height, error);
 }
 
-static void
-resize_callback (CoglOnscreen *onscreen,
-                 int width,
-                 int height,
-                 void *user_data)
+static gboolean
+opt_live_test_source_cb (const char *option_name,
+                         const char *value,
+                         void *data,
+                         GError **error)
 {
-  Data *data = user_data;
-
-  data->onscreen_width = width;
-  data->onscreen_height = height;
+  opt_live = TRUE;
 
-  cogl_framebuffer_orthographic (data->fb, 0, 0, width, height, -1, 100);
-
-  if (cogl_gst_video_sink_is_ready (data->sink))
-    update_video_output (data);
+  return opt_test_source_cb (option_name, value, data, error);
 }
 
-static void
-set_up_pipeline (gpointer instance,
-                 gpointer user_data)
+static gboolean
+opt_contact_sheet_cb (const char *option_name,
+                      const char *value,
+                      void *data,
+                      GError **error)
 {
-  Data *data = (Data *) user_data;
+  return parse_size (value,
+                     &opt_contact_sheet_columns,
+                     &opt_contact_sheet_rows,
+                     error);
+}
 
-  update_video_output (data);
+static GOptionEntry
+main_options[] =
+  {
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_CALLBACK, &opt_filename_cb,
+      "File or URL to play", "FILE" },
+    { "playlist", 0, 0, G_OPTION_ARG_CALLBACK, &opt_playlist_cb,
+      "Play the files or URLs listed one per line in FILE in a loop",
+      "FILE" },
+    { "images", 0, 0, G_OPTION_ARG_CALLBACK, &opt_images_cb,
+      "Play a directory or glob of PNG or JPEG images in a loop",
+      "PATTERN" },
+    { "frame-rate", 0, 0, G_OPTION_ARG_INT, &opt_frame_rate,
+      "Frame rate of the images (default 30)", "FPS" },
+    { "headless", 0, 0, G_OPTION_ARG_NONE, &opt_headless,
+      "Render to an offscreen framebuffer without a window. Use "
+      "SDL_VIDEODRIVER=offscreen on machines without a display", NULL },
+    { "size", 0, 0, G_OPTION_ARG_CALLBACK, &opt_size_cb,
+      "Initial size of the framebuffer", "WIDTHxHEIGHT" },
+    { "dump-frames", 0, 0, G_OPTION_ARG_FILENAME, &opt_dump_dir,
+      "Save each frame rendered in headless mode as a PPM file in DIR",
+      "DIR" },
+    { "test-source", 0, 0, G_OPTION_ARG_CALLBACK, &opt_test_source_cb,
+      "Play a generated test video of the given size instead of a file",
+      "WIDTHxHEIGHT" },
+    { "live-test-source", 0, 0, G_OPTION_ARG_CALLBACK,
+      &opt_live_test_source_cb,
+      "Like --test-source but as a live source. This implies --live",
+      "WIDTHxHEIGHT" },
+    { "effect", 0, 0, G_OPTION_ARG_STRING, &opt_effect,
+      "Name or number of the effect to start with", "EFFECT" },
+    { "list-effects", 0, 0, G_OPTION_ARG_NONE, &opt_list_effects,
+      "List the available effects and exit", NULL },
+    { "frames", 0, 0, G_OPTION_ARG_INT, &opt_frames,
+      "Quit after painting N frames", "N" },
+    { "decode-only", 0, 0, G_OPTION_ARG_NONE, &opt_decode_only,
+      "Decode the video as fast as possible without rendering it", NULL },
+    { "uncapped", 0, 0, G_OPTION_ARG_NONE, &opt_uncapped,
+      "Don't synchronise the video to the clock or the display", NULL },
+    { "json", 0, 0, G_OPTION_ARG_NONE, &opt_json,
+      "Print the frame statistics as JSON before quitting", NULL },
+    { "gpu-timing", 0, 0, G_OPTION_ARG_NONE, &opt_gpu_timing,
+      "Measure the GPU time of each effect with timer queries", NULL },
+    { "trace", 0, 0, G_OPTION_ARG_FILENAME, &opt_trace_file,
+      "Record a timeline of each frame in the Chrome trace-event format "
+      "to FILE", "FILE" },
+    { "metrics-socket", 0, 0, G_OPTION_ARG_FILENAME, &opt_metrics_socket,
+      "Serve live metrics on a UNIX domain socket at PATH", "PATH" },
+    { "swap-interval", 0, 0, G_OPTION_ARG_INT, &opt_swap_interval,
+      "Number of vblanks to wait for between each swap (default 1)", "N" },
+    { "realtime", 0, 0, G_OPTION_ARG_NONE, &opt_realtime,
+      "Run the render thread with real-time scheduling", NULL },
+    { "render-cpu", 0, 0, G_OPTION_ARG_INT, &opt_render_cpu,
+      "Pin the render thread to CPU N", "N" },
+    { "max-queued-frames", 0, 0, G_OPTION_ARG_INT, &opt_max_queued_frames,
+      "Maximum number of decoded frames to hold waiting for the "
+      "renderer (default 4)", "N" },
+    { "async-upload", 0, 0, G_OPTION_ARG_NONE, &opt_async_upload,
+      "Upload the video frames on a separate thread", NULL },
+    { "no-sink-pool", 0, G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE,
+      &opt_sink_pool,
+      "Don't propose a buffer pool to the decoder", NULL },
+    { "skip-duplicates", 0, 0, G_OPTION_ARG_NONE, &opt_skip_duplicates,
+      "Don't repaint frames that look the same as the last one", NULL },
+    { "no-gapless-loop", 0, G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE,
+      &opt_gapless_loop,
+      "Loop the video with a flushing seek after it ends", NULL },
+    { "loop-cache", 0, 0, G_OPTION_ARG_INT, &opt_loop_cache,
+      "Decode the video once and play the later loops from a cache "
+      "of up to this many megabytes (default 0, disabled)", "MB" },
+    { "frame-history", 0, 0, G_OPTION_ARG_INT, &opt_frame_history,
+      "Number of recent frames to keep for stepping backwards in a "
+      "window (default 0, disabled)", "N" },
+    { "prewarm-effects", 0, 0, G_OPTION_ARG_NONE, &opt_prewarm_effects,
+      "Initialise all of the effects at startup and compile their "
+      "shaders while idle so that switching doesn't stall", NULL },
+    { "shader-cache-dir", 0, 0, G_OPTION_ARG_FILENAME,
+      &opt_shader_cache_dir,
+      "Directory for the GL driver to keep compiled shaders in between "
+      "runs (default $XDG_CACHE_HOME/sprite-player/shaders)", "DIR" },
+    { "no-shader-cache", 0, G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE,
+      &opt_shader_cache,
+      "Make the GL driver compile the shaders from scratch every run",
+      NULL },
+    { "live", 0, 0, G_OPTION_ARG_NONE, &opt_live,
+      "Set up for a live source with the least latency and measure the "
+      "time from capture to presentation", NULL },
+    { "latency", 0, 0, G_OPTION_ARG_INT, &opt_latency,
+      "Latency of the pipeline with --live instead of the one reported "
+      "by the elements", "MS" },
+    { "control-socket", 0, 0, G_OPTION_ARG_FILENAME, &opt_control_socket,
+      "Accept commands to load a video, change the effect, seek, pause "
+      "and get the status on a UNIX socket", "PATH" },
+    { "contact-sheet", 0, 0, G_OPTION_ARG_CALLBACK, &opt_contact_sheet_cb,
+      "Save a grid of frames from evenly spaced times through the video "
+      "with the effect applied to a PNG the size of --size and exit",
+      "COLUMNSxROWS" },
+    { "contact-sheet-output", 0, 0, G_OPTION_ARG_FILENAME,
+      &opt_contact_sheet_output,
+      "File to save the contact sheet to (default contact-sheet.png)",
+      "FILE" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+  };
 
-  data->current_effect->set_up_pipeline (data->sink,
-                                         data->effect_data);
+static double
+get_rate (Data *data)
+{
+  return 1 << data->rate_num;
 }
 
-static void
-clear_effect (Data *data)
+static GstSeekFlags
+get_trick_mode_flags (Data *data)
 {
-  if (data->current_effect)
-    {
-      data->current_effect->fini (data->effect_data);
-      data->current_effect = NULL;
-    }
+  /* Above normal speed only the keyframes are decoded so that the
+   * decoder can keep up */
+  if (data->rate_num > 0)
+    return (GST_SEEK_FLAG_TRICKMODE |
+            GST_SEEK_FLAG_TRICKMODE_KEY_UNITS |
+            GST_SEEK_FLAG_TRICKMODE_NO_AUDIO);
+  else
+    return 0;
 }
 
 static void
-set_effect (Data *data,
-            const Effect *effect)
+seek_to_start (Data *data,
+               GstSeekFlags flags)
 {
-  clear_effect (data);
+  g_atomic_int_set (&data->loop_seek_pending, TRUE);
+
+  gst_element_seek (data->playbin,
+                    get_rate (data),
+                    GST_FORMAT_TIME,
+                    flags | get_trick_mode_flags (data),
+                    GST_SEEK_TYPE_SET, 0,
+                    GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
+}
 
-  /* Reset the sink options to a known state */
-  cogl_gst_video_sink_set_default_sample (data->sink, TRUE);
-  cogl_gst_video_sink_set_first_layer (data->sink, 0);
+static gboolean
+play_from_cache_cb (void *user_data)
+{
+  Data *data = user_data;
 
-  data->effect_data = effect->init (data->context, data->sink);
-  data->current_effect = effect;
+  /* The pipeline is restarted so that the timestamps from the appsrc
+   * start from a new base time. source_setup_cb will see that the
+   * cache is complete */
+  gst_element_set_state (data->pipeline, GST_STATE_READY);
+  frame_queue_discard (data->frame_queue);
+  g_object_set (data->playbin, "uri", "appsrc://", NULL);
+  gst_element_set_state (data->pipeline, GST_STATE_PLAYING);
 
-  /* If the pipeline is already ready then we can immediately set it
-   * up */
-  if (cogl_gst_video_sink_is_ready (data->sink))
-    effect->set_up_pipeline (data->sink, data->effect_data);
+  return G_SOURCE_REMOVE;
 }
 
-static gboolean
-process_arguments (int *argc,
-                   char ***argv,
-                   GError **error)
+static void
+source_setup_cb (GstElement *playbin,
+                 GstElement *source,
+                 void *user_data)
 {
-  GOptionContext *context;
-  gboolean ret;
-  GOptionGroup *group, *gst_group;
+  Data *data = user_data;
 
-  group = g_option_group_new (NULL, /* name */
-                              NULL, /* description */
-                              NULL, /* help_description */
-                              NULL, /* user_data */
-                              NULL /* destroy notify */);
-  g_option_group_add_entries (group, main_options);
-  context = g_option_context_new ("- A sample video player with effects");
-  g_option_context_set_main_group (context, group);
+  if (data->loop_cache &&
+      loop_cache_is_complete (data->loop_cache) &&
+      GST_IS_APP_SRC (source))
+    loop_cache_attach (data->loop_cache, GST_APP_SRC (source));
+}
 
-  gst_group = gst_init_get_option_group ();
-  g_option_context_add_group (context, gst_group);
+static void
+about_to_finish_cb (GstElement *playbin,
+                    void *user_data)
+{
+  Data *data = user_data;
 
-  ret = g_option_context_parse (context, argc, argv, error);
+  /* Setting the URI from here makes playbin build and preroll the
+   * decoders for the next item while the queued frames of this one
+   * are still being shown. It then switches over at the end without
+   * a gap */
+  if (opt_playlist[++data->playlist_pos] == NULL)
+    data->playlist_pos = 0;
 
-  g_option_context_free (context);
+  g_atomic_int_set (&data->loop_seek_pending, TRUE);
 
-  if (ret && *argc > 1)
+  g_object_set (playbin, "uri", opt_playlist[data->playlist_pos], NULL);
+}
+
+static void
+finish_pending_request (Data *data)
+{
+  if (data->pending_timeout)
     {
-      g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_UNKNOWN_OPTION,
-                   "Unknown option '%s'", (* argv)[1]);
-      ret = FALSE;
+      g_source_destroy (data->pending_timeout);
+      g_source_unref (data->pending_timeout);
+      data->pending_timeout = NULL;
     }
 
-  return ret;
+  data->pending_request = NULL;
 }
 
 static void
-handle_key_press (Data *data,
-                  int keysym)
+fail_pending_request (Data *data,
+                      const char *message)
 {
-  if (keysym >= SDLK_0 && keysym <= SDLK_9)
-    {
-      int effect_num = keysym - SDLK_0;
+  control_request_reply (data->pending_request, "ERROR %s", message);
+  finish_pending_request (data);
 
-      if (effect_num < N_EFFECTS)
-        set_effect (data, effects[effect_num]);
-    }
+  /* The render thread is told to stop waiting for a frame that will
+   * never come */
+  channel_send (data->to_render, MESSAGE_WAIT_FOR_FRAME, 0);
 }
 
 static gboolean
-event_timeout_cb (void *user_data)
+bus_watch (GstBus *bus,
+           GstMessage *msg,
+           void *user_data)
 {
-  Data *data = user_data;
-  SDL_Event event;
+  Data *data = (Data *) user_data;
+  int64_t trace_start = trace_begin ();
 
-  while (SDL_PollEvent (&event))
+  switch (GST_MESSAGE_TYPE (msg))
     {
-      switch (event.type)
+      case GST_MESSAGE_ASYNC_DONE:
         {
-        case SDL_KEYDOWN:
-          handle_key_press (data, event.key.keysym.sym);
-          break;
-
-        case SDL_WINDOWEVENT:
-          switch (event.window.event)
+          /* Once the pipeline has prerolled, playback is restarted
+           * with a segment seek so that we get SEGMENT_DONE instead
+           * of EOS at the end */
+          if (data->playbin &&
+              opt_gapless_loop &&
+              !opt_live &&
+              opt_video_type != VIDEO_TYPE_PLAYLIST &&
+              !data->segment_seek_done)
             {
-            case SDL_WINDOWEVENT_CLOSE:
-              g_main_quit (data->main_loop);
-              break;
+              data->segment_seek_done = TRUE;
+              gst_element_seek (data->playbin,
+                                get_rate (data),
+                                GST_FORMAT_TIME,
+                                GST_SEEK_FLAG_FLUSH |
+                                GST_SEEK_FLAG_SEGMENT |
+                                get_trick_mode_flags (data),
+                                GST_SEEK_TYPE_SET, 0,
+                                GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
             }
           break;
-
-        case SDL_QUIT:
-          g_main_quit (data->main_loop);
+        }
+      case GST_MESSAGE_SEGMENT_DONE:
+        {
+          /* A non-flushing seek lets the decoder carry on straight
+           * into the next loop without prerolling again */
+          if (data->playbin)
+            seek_to_start (data, GST_SEEK_FLAG_SEGMENT);
           break;
-
-        default:
+        }
+      case GST_MESSAGE_EOS:
+        {
+          /* This is only reached if the segment seek didn't work */
+          if (data->playbin)
+            seek_to_start (data, GST_SEEK_FLAG_FLUSH);
           break;
         }
+      case GST_MESSAGE_ERROR:
+        {
+          char *debug;
+          GError *error = NULL;
 
-      cogl_sdl_handle_event (data->context, &event);
+          gst_message_parse_error (msg, &error, &debug);
+          g_free (debug);
+
+          g_atomic_int_inc (&data->stats.bus_errors);
+
+          if (error != NULL)
+            g_warning ("Playback error: %s", error->message);
+
+          if (data->control_server)
+            {
+              /* Keep running so that another video can be loaded */
+              if (data->pending_request)
+                fail_pending_request (data,
+                                      error ?
+                                      error->message :
+                                      "Playback failed");
+            }
+          else
+            {
+              g_main_loop_quit (data->main_loop);
+            }
+
+          g_clear_error (&error);
+          break;
+        }
+      default:
+        break;
     }
 
-  return G_SOURCE_CONTINUE;
+  /* The message type names are static strings */
+  trace_end (GST_MESSAGE_TYPE_NAME (msg), trace_start);
+
+  return TRUE;
 }
 
-static CoglOnscreen *
-create_onscreen (Data *data)
+static void
+dump_frame (Data *data)
 {
-  CoglOnscreen *onscreen;
+  int width = cogl_framebuffer_get_width (data->fb);
+  int height = cogl_framebuffer_get_height (data->fb);
+  uint8_t *pixels = g_malloc (width * height * 3);
+  char *basename, *filename;
+  FILE *out;
 
-  onscreen = cogl_onscreen_new (data->context, 800, 600);
-  cogl_onscreen_set_resizable (onscreen, TRUE);
-  cogl_onscreen_add_resize_callback (onscreen, resize_callback, data, NULL);
-  cogl_framebuffer_allocate (COGL_FRAMEBUFFER (onscreen), NULL);
+  cogl_framebuffer_read_pixels (data->fb,
+                                0, 0, /* x, y */
+                                width, height,
+                                COGL_PIXEL_FORMAT_RGB_888,
+                                pixels);
 
-  return onscreen;
-}
+  basename = g_strdup_printf ("frame-%06i.ppm", data->dump_frame_num++);
+  filename = g_build_filename (opt_dump_dir, basename, NULL);
 
-int
-main (int argc,
-      char **argv)
+  out = fopen (filename, "wb");
+
+  if (out == NULL)
+    {
+      g_warning ("%s: %s", filename, strerror (errno));
+    }
+  else
+    {
+      fprintf (out, "P6\n%i %i\n255\n", width, height);
+      fwrite (pixels, 3, width * height, out);
+      fclose (out);
+    }
+
+  g_free (filename);
+  g_free (basename);
+  g_free (pixels);
+}
+
+static int64_t
+get_capture_time (Data *data)
+{
+  GstElement *sink = GST_ELEMENT (data->sink);
+  GstBuffer *buffer = data->current_frame.buffer;
+  const GstSegment *segment;
+  GstClockTime running_time;
+  GstEvent *event;
+  GstClock *clock;
+  GstPad *pad;
+  int64_t capture_time = -1;
+
+  if (buffer == NULL || !GST_BUFFER_PTS_IS_VALID (buffer))
+    return -1;
+
+  pad = gst_element_get_static_pad (sink, "sink");
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+  gst_object_unref (pad);
+
+  if (event == NULL)
+    return -1;
+
+  gst_event_parse_segment (event, &segment);
+  running_time = gst_segment_to_running_time (segment,
+                                              GST_FORMAT_TIME,
+                                              GST_BUFFER_PTS (buffer));
+  gst_event_unref (event);
+
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return -1;
+
+  clock = gst_element_get_clock (sink);
+
+  if (clock)
+    {
+      /* Live sources timestamp each buffer with the time at which it
+       * was captured. Its running time is converted to the monotonic
+       * clock the same way as the target times but without the
+       * latency */
+      capture_time = (g_get_monotonic_time () * 1000 +
+                      GST_CLOCK_DIFF (gst_clock_get_time (clock),
+                                      running_time +
+                                      gst_element_get_base_time (sink)));
+      gst_object_unref (clock);
+    }
+
+  return capture_time;
+}
+
+static void
+add_glass_latency (Data *data,
+                   int64_t capture_time,
+                   int64_t presentation_time)
+{
+  if (capture_time > 0 && presentation_time > capture_time)
+    histogram_add (data->stats.glass_latency,
+                   presentation_time - capture_time);
+}
+
+static void
+paint_cb (void *user_data)
+{
+  Data *data = user_data;
+  int64_t start_time = g_get_monotonic_time ();
+  int64_t effect_end_time, end_time;
+  int64_t trace_start;
+  TextureAttachCounts attach_counts;
+  StatsEffect *effect_stats;
+
+  if (data->gpu_timer)
+    gpu_timer_begin (data->gpu_timer, data->current_effect_num);
+
+  trace_start = trace_begin ();
+
+  data->current_effect->paint (data->fb,
+                               &data->video_output,
+                               data->effect_data);
+
+  trace_end ("effect-paint", trace_start);
+
+  effect_end_time = g_get_monotonic_time ();
+
+  /* The query is ended before the swap so that it only covers the
+   * effect's rendering and not the swap or any blit by the window
+   * system. Cogl has to flush its journal first because the effect's
+   * rendering is still batched up in it */
+  if (data->gpu_timer)
+    {
+      cogl_flush ();
+      gpu_timer_end (data->gpu_timer,
+                     (effect_end_time - start_time) * 1000);
+    }
+
+  texture_uploader_take_attach_counts (data->sink, &attach_counts);
+  effect_stats = data->stats.effect_stats + data->current_effect_num;
+  effect_stats->attach_hits += attach_counts.hits;
+  effect_stats->attach_retargets += attach_counts.retargets;
+
+  if (data->headless)
+    {
+      /* Nothing else will flush the rendering for an offscreen
+       * framebuffer so we wait for it here. That way the frame rate
+       * reflects what the GPU can actually sustain */
+      cogl_framebuffer_finish (data->fb);
+
+      if (opt_live)
+        add_glass_latency (data,
+                           get_capture_time (data),
+                           g_get_monotonic_time () * 1000);
+    }
+  else
+    {
+      if (!data->swap_interval_applied)
+        {
+          /* The swap interval is set on whichever GL context is
+           * current so this has to wait until Cogl has bound the
+           * onscreen for painting */
+          SDL_GL_SetSwapInterval (opt_uncapped ? 0 : opt_swap_interval);
+          data->swap_interval_applied = TRUE;
+        }
+
+      /* The latency is worked out when the swap completes */
+      if (opt_live)
+        {
+          CoglOnscreen *onscreen = COGL_ONSCREEN (data->fb);
+          int64_t frame_counter = cogl_onscreen_get_frame_counter (onscreen);
+          PendingSwap *swap =
+            data->pending_swaps + frame_counter % MAX_PENDING_SWAPS;
+
+          swap->frame_counter = frame_counter;
+          swap->capture_time = get_capture_time (data);
+        }
+
+      trace_start = trace_begin ();
+      cogl_onscreen_swap_buffers (COGL_ONSCREEN (data->fb));
+      trace_end ("swap-buffers", trace_start);
+    }
+
+  if (data->headless && opt_dump_dir)
+    dump_frame (data);
+
+  end_time = g_get_monotonic_time ();
+
+  histogram_add (data->stats.paint_time, (end_time - start_time) * 1000);
+
+  if (data->seek_start_time &&
+      data->current_frame.buffer &&
+      data->current_frame.arrival_time >= data->seek_start_time)
+    {
+      int64_t latency = end_time * 1000 - data->seek_start_time;
+
+      histogram_add (data->stats.seek_latency, latency);
+      data->seek_start_time = 0;
+
+      if (!opt_json)
+        g_print ("Seek took %.1f ms\n", latency / 1e6);
+    }
+
+  if (data->effect_switch_time)
+    {
+      int64_t latency = end_time * 1000 - data->effect_switch_time;
+
+      histogram_add (data->stats.effect_switch_latency, latency);
+      data->effect_switch_time = 0;
+
+      if (!opt_json)
+        g_print ("Switching to %s took %.1f ms\n",
+                 data->current_effect->name,
+                 latency / 1e6);
+    }
+
+  if (data->command_start_time &&
+      (!data->command_needs_new_frame ||
+       (data->current_frame.buffer &&
+        data->current_frame.arrival_time >= data->command_start_time)))
+    {
+      int64_t latency = end_time * 1000 - data->command_start_time;
+
+      histogram_add (data->stats.command_latency, latency);
+      channel_send_tagged (data->to_control,
+                           MESSAGE_COMMAND_DONE,
+                           data->command_tag,
+                           latency);
+      data->command_start_time = 0;
+    }
+
+  if (data->current_frame.buffer)
+    {
+      histogram_add (data->stats.queue_latency,
+                     end_time * 1000 - data->current_frame.arrival_time);
+      gst_buffer_unref (data->current_frame.buffer);
+      data->current_frame.buffer = NULL;
+    }
+
+  if (data->stats.first_paint_time == 0)
+    data->stats.first_paint_time = end_time;
+
+  if (++data->stats.frames_painted == opt_frames)
+    {
+      data->stats.end_time = end_time;
+      g_main_loop_quit (data->main_loop);
+    }
+}
+
+static void
+swap_completed (Data *data,
+                CoglFrameInfo *info)
+{
+  int64_t frame_counter = cogl_frame_info_get_frame_counter (info);
+  int64_t presentation_time = cogl_frame_info_get_presentation_time (info);
+  int64_t now = g_get_monotonic_time () * 1000;
+  PendingSwap *swap =
+    data->pending_swaps + frame_counter % MAX_PENDING_SWAPS;
+
+  if (swap->frame_counter != frame_counter)
+    return;
+
+  /* Fall back to the completion time if the driver doesn't give a
+   * presentation time on the monotonic clock */
+  if (presentation_time == 0 ||
+      ABS (presentation_time - now) > GST_SECOND)
+    presentation_time = now;
+
+  add_glass_latency (data, swap->capture_time, presentation_time);
+  swap->capture_time = -1;
+}
+
+static void
+frame_callback (CoglOnscreen *onscreen,
+                CoglFrameEvent event,
+                CoglFrameInfo *info,
+                void *user_data)
+{
+  Data *data = user_data;
+
+  if (event == COGL_FRAME_EVENT_SYNC)
+    {
+      int64_t trace_start = trace_begin ();
+
+      frame_scheduler_sync (data->scheduler);
+
+      trace_end ("frame-sync", trace_start);
+    }
+  else if (event == COGL_FRAME_EVENT_COMPLETE)
+    {
+      int64_t refresh_interval;
+
+      frame_scheduler_presented (data->scheduler,
+                                 cogl_frame_info_get_presentation_time (info),
+                                 cogl_frame_info_get_refresh_rate (info));
+
+      if (opt_live)
+        swap_completed (data, info);
+
+      /* Get the sink to hand over each frame a refresh early so that
+       * the scheduler can hold it until the right vblank rather than
+       * it arriving just after and being shown a vblank late */
+      refresh_interval =
+        frame_scheduler_get_refresh_interval (data->scheduler);
+
+      if (!opt_uncapped && refresh_interval != data->ts_offset)
+        {
+          g_object_set (data->sink, "ts-offset", -refresh_interval, NULL);
+          data->ts_offset = refresh_interval;
+        }
+    }
+}
+
+static int64_t
+get_target_time (Data *data,
+                 const GstSegment *segment,
+                 GstClockTime pts)
+{
+  GstElement *sink = GST_ELEMENT (data->sink);
+  GstClock *clock;
+  int64_t target_time = -1;
+
+  /* There is no clock while the pipeline isn't playing */
+  clock = gst_element_get_clock (sink);
+
+  if (clock)
+    {
+      GstClockTime running_time, clock_time;
+
+      running_time = gst_segment_to_running_time (segment,
+                                                  GST_FORMAT_TIME,
+                                                  pts);
+
+      if (GST_CLOCK_TIME_IS_VALID (running_time))
+        {
+          /* This is when the sink would have rendered the buffer
+           * without the ts-offset. It is converted to the monotonic
+           * clock by its distance from the current time */
+          clock_time = (running_time +
+                        gst_element_get_base_time (sink) +
+                        gst_base_sink_get_latency (GST_BASE_SINK (sink)));
+          target_time = (g_get_monotonic_time () * 1000 +
+                         GST_CLOCK_DIFF (gst_clock_get_time (clock),
+                                         clock_time));
+        }
+
+      gst_object_unref (clock);
+    }
+
+  return target_time;
+}
+
+static int64_t
+get_frame_target_time (Data *data,
+                       GstSample *sample)
+{
+  return get_target_time (data,
+                          gst_sample_get_segment (sample),
+                          GST_BUFFER_PTS (gst_sample_get_buffer (sample)));
+}
+
+static void
+set_current_frame (Data *data,
+                   const QueuedFrame *frame)
+{
+  /* The scheduler counts the previous frame as dropped if it wasn't
+   * painted */
+  if (data->current_frame.buffer)
+    gst_buffer_unref (data->current_frame.buffer);
+
+  data->current_frame = *frame;
+}
+
+static void
+count_decoded_frame (Data *data)
+{
+  if (data->stats.frames_decoded++ == 0)
+    data->stats.start_time = g_get_monotonic_time ();
+}
+
+static void
+frame_arrived (Data *data,
+               int64_t target_time)
+{
+  count_decoded_frame (data);
+
+  frame_scheduler_frame_arrived (data->scheduler, target_time);
+}
+
+static void
+duplicate_frame_arrived (Data *data,
+                         int64_t target_time)
+{
+  data->stats.frames_duplicate++;
+
+  /* If the effect only depends on the frame then the last paint is
+   * still correct */
+  if (data->current_effect->flags & EFFECT_FLAG_ANIMATED)
+    {
+      frame_arrived (data, target_time);
+    }
+  else
+    {
+      count_decoded_frame (data);
+      data->stats.repaints_skipped++;
+    }
+}
+
+static void
+dequeue_frame (Data *data,
+               GstSample *sample)
+{
+  QueuedFrame frame;
+  int n_skipped;
+  bool found;
+
+  found = frame_queue_pop_to (data->frame_queue,
+                              gst_sample_get_buffer (sample),
+                              &frame,
+                              &n_skipped);
+
+  data->stats.frames_dropped += n_skipped;
+
+  if (found)
+    set_current_frame (data, &frame);
+}
+
+static void
+new_frame_cb (CoglGstVideoSink *sink,
+              Data *data)
+{
+  int64_t trace_start = trace_begin ();
+  int64_t target_time = -1;
+  GstSample *sample;
+
+  if (data->uploader)
+    texture_uploader_use_sink_frame (data->uploader);
+
+  g_object_get (data->sink, "last-sample", &sample, NULL);
+
+  if (sample)
+    {
+      dequeue_frame (data, sample);
+
+      if (data->frame_history)
+        frame_history_add (data->frame_history);
+
+      /* The presentation time only matters when painting is
+       * synchronised to the display */
+      if (!data->headless && !opt_uncapped)
+        target_time = get_frame_target_time (data, sample);
+
+      gst_sample_unref (sample);
+    }
+
+  frame_arrived (data, target_time);
+
+  trace_end ("new-frame", trace_start);
+}
+
+static void
+uploaded_frame_cb (GstBuffer *buffer,
+                   int64_t target_time,
+                   int64_t arrival_time,
+                   void *user_data)
+{
+  Data *data = user_data;
+  QueuedFrame frame;
+
+  frame.buffer = buffer;
+  frame.arrival_time = arrival_time;
+  set_current_frame (data, &frame);
+
+  if (data->frame_history)
+    frame_history_add (data->frame_history);
+
+  frame_arrived (data, target_time);
+}
+
+static void
+handoff_cb (GstElement *fakesink,
+            GstBuffer *buffer,
+            GstPad *pad,
+            Data *data)
+{
+  /* This is called from the streaming thread in decode-only mode */
+  int frame_num = g_atomic_int_add (&data->stats.frames_decoded, 1);
+
+  if (frame_num == 0)
+    data->stats.start_time = g_get_monotonic_time ();
+
+  if (frame_num + 1 == opt_frames)
+    {
+      data->stats.end_time = g_get_monotonic_time ();
+      g_main_loop_quit (data->main_loop);
+    }
+}
+
+/* Used for the frames that never reach the sink so that the scheduler
+ * can hold them until their presentation time */
+static int64_t
+get_buffer_target_time (Data *data,
+                        GstPad *pad,
+                        GstBuffer *buffer)
+{
+  const GstSegment *segment;
+  GstEvent *event;
+  int64_t target_time;
+
+  if (data->headless || opt_uncapped)
+    return -1;
+
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+
+  if (event == NULL)
+    return -1;
+
+  gst_event_parse_segment (event, &segment);
+  target_time = get_target_time (data, segment, GST_BUFFER_PTS (buffer));
+  gst_event_unref (event);
+
+  return target_time;
+}
+
+static GstPadProbeReturn
+queue_buffer_probe (GstPad *pad,
+                    GstPadProbeInfo *info,
+                    void *user_data)
+{
+  Data *data = user_data;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  int64_t now = g_get_monotonic_time () * 1000;
+
+  if (data->measure_loop_gap)
+    {
+      channel_send (data->from_streaming,
+                    MESSAGE_LOOP,
+                    now - data->last_buffer_arrival);
+      data->measure_loop_gap = false;
+    }
+
+  data->last_buffer_arrival = now;
+
+  /* Every frame is recorded, including the duplicates */
+  if (data->loop_cache)
+    loop_cache_record (data->loop_cache, buffer);
+
+  /* There is no need to upload a frame that is the same as the last
+   * one. It is only dropped once it is due so that the decoder is
+   * still held back by the clock. The render thread still gets told
+   * about it so that animated effects keep moving. While the sink
+   * isn't playing the frame is given to it so that it can preroll */
+  if (data->duplicate_detector &&
+      duplicate_detector_check (data->duplicate_detector, buffer) &&
+      sink_clock_wait (data->sink_clock, buffer))
+    {
+      channel_send (data->from_streaming,
+                    MESSAGE_DUPLICATE_FRAME,
+                    get_buffer_target_time (data, pad, buffer));
+      return GST_PAD_PROBE_DROP;
+    }
+
+  if (data->uploader &&
+      texture_uploader_push (data->uploader,
+                             buffer,
+                             get_buffer_target_time (data, pad, buffer),
+                             now))
+    return GST_PAD_PROBE_DROP;
+
+  /* If the queue is full the frame will still be shown but it won't
+   * be included in the statistics */
+  frame_queue_push (data->frame_queue, buffer, now);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+allocation_query_probe (GstPad *pad,
+                        GstPadProbeInfo *info,
+                        void *user_data)
+{
+  GstQuery *query = GST_PAD_PROBE_INFO_QUERY (info);
+
+  /* CoglGstVideoSink doesn't propose any allocation itself */
+  if (GST_QUERY_TYPE (query) == GST_QUERY_ALLOCATION &&
+      allocation_propose_pool (query))
+    return GST_PAD_PROBE_HANDLED;
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+sink_event_probe (GstPad *pad,
+                  GstPadProbeInfo *info,
+                  void *user_data)
+{
+  Data *data = user_data;
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT &&
+      g_atomic_int_compare_and_exchange (&data->loop_seek_pending,
+                                         TRUE,
+                                         FALSE))
+    {
+      data->measure_loop_gap = data->last_buffer_arrival != 0;
+
+      if (data->loop_cache && loop_cache_finish (data->loop_cache))
+        g_main_context_invoke (data->control_context,
+                               play_from_cache_cb,
+                               data);
+    }
+
+  /* The queued frames won't reach the renderer after a flush */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+    frame_queue_discard (data->frame_queue);
+
+  if (data->loop_cache)
+    loop_cache_handle_event (data->loop_cache, event);
+
+  if (data->uploader)
+    texture_uploader_handle_event (data->uploader, event);
+
+  if (data->duplicate_detector)
+    {
+      duplicate_detector_handle_event (data->duplicate_detector, event);
+      sink_clock_handle_event (data->sink_clock, event);
+    }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+trace_buffer_probe (GstPad *pad,
+                    GstPadProbeInfo *info,
+                    void *user_data)
+{
+  /* Marks when each buffer reaches the sink on the streaming thread.
+   * The sink will then wait for the clock before rendering it */
+  trace_set_thread_name ("streaming");
+  trace_end ("sink-buffer", trace_begin ());
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+update_video_output (Data *data)
+{
+  CoglGstRectangle available;
+
+  available.x = 0;
+  available.y = 0;
+  available.width = data->onscreen_width;
+  available.height = data->onscreen_height;
+
+  cogl_gst_video_sink_fit_size (data->sink,
+                                &available,
+                                &data->video_output);
+}
+
+static void
+resize_callback (CoglOnscreen *onscreen,
+                 int width,
+                 int height,
+                 void *user_data)
+{
+  Data *data = user_data;
+
+  data->onscreen_width = width;
+  data->onscreen_height = height;
+
+  cogl_framebuffer_orthographic (data->fb, 0, 0, width, height, -1, 100);
+
+  if (cogl_gst_video_sink_is_ready (data->sink))
+    update_video_output (data);
+}
+
+static void
+warm_effect (Data *data,
+             int effect_num)
+{
+  const Effect *effect = effects[effect_num];
+  CoglGstRectangle video_output;
+  TextureAttachCounts attach_counts;
+
+  if (data->warm_fb == NULL)
+    {
+      CoglTexture2D *texture =
+        cogl_texture_2d_new_with_size (data->context,
+                                       WARM_FB_SIZE, WARM_FB_SIZE,
+                                       COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                       NULL /* error */);
+      CoglOffscreen *offscreen =
+        cogl_offscreen_new_with_texture (COGL_TEXTURE (texture));
+
+      cogl_object_unref (texture);
+
+      data->warm_fb = COGL_FRAMEBUFFER (offscreen);
+      cogl_framebuffer_orthographic (data->warm_fb,
+                                     0, 0, WARM_FB_SIZE, WARM_FB_SIZE,
+                                     -1, 100);
+    }
+
+  video_output.x = 0;
+  video_output.y = 0;
+  video_output.width = WARM_FB_SIZE;
+  video_output.height = WARM_FB_SIZE;
+
+  effect_set_up_sink (effect, data->sink);
+  effect->set_up_pipeline (data->sink, data->prewarmed_data[effect_num]);
+  effect->paint (data->warm_fb,
+                 &video_output,
+                 data->prewarmed_data[effect_num]);
+
+  /* Cogl only compiles the shaders when the journal is flushed.
+   * They are then kept in its program cache so the effect's pipeline
+   * won't need compiling again when it is set up for real */
+  cogl_framebuffer_finish (data->warm_fb);
+
+  /* The warm-up paints shouldn't count towards the effects' stats */
+  texture_uploader_take_attach_counts (data->sink, &attach_counts);
+
+  /* Put the sink back how the current effect wants it */
+  effect_set_up_sink (data->current_effect, data->sink);
+  data->current_effect->set_up_pipeline (data->sink, data->effect_data);
+}
+
+static gboolean
+warm_effects_cb (void *user_data)
+{
+  Data *data = user_data;
+  int effect_num = data->n_warm_effects++;
+  int64_t trace_start = trace_begin ();
+
+  /* The current effect has already been compiled by painting it */
+  if (effects[effect_num] != data->current_effect)
+    warm_effect (data, effect_num);
+
+  trace_end ("warm-effect", trace_start);
+
+  if (data->n_warm_effects >= N_EFFECTS)
+    {
+      data->warm_source = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+set_up_pipeline (gpointer instance,
+                 gpointer user_data)
+{
+  Data *data = (Data *) user_data;
+
+  update_video_output (data);
+
+  data->current_effect->set_up_pipeline (data->sink,
+                                         data->effect_data);
+
+  /* The shaders depend on the video format so they are compiled
+   * again whenever the sink is set up for new caps. This is done
+   * from an idle source so that it doesn't hold up the first frame.
+   * Cogl can only be used from this thread so it can't be done in
+   * the background */
+  if (opt_prewarm_effects)
+    {
+      data->n_warm_effects = 0;
+
+      if (data->warm_source == 0)
+        data->warm_source = g_idle_add_full (G_PRIORITY_LOW,
+                                             warm_effects_cb,
+                                             data,
+                                             NULL /* notify */);
+    }
+}
+
+static void
+prewarm_effects (Data *data)
+{
+  int i;
+
+  for (i = 0; i < N_EFFECTS; i++)
+    {
+      effect_set_up_sink (effects[i], data->sink);
+      data->prewarmed_data[i] = effects[i]->init (data->context,
+                                                  data->sink);
+    }
+}
+
+static void
+clear_effect (Data *data)
+{
+  int i;
+
+  if (data->warm_source)
+    {
+      g_source_remove (data->warm_source);
+      data->warm_source = 0;
+    }
+
+  if (data->warm_fb)
+    {
+      cogl_object_unref (data->warm_fb);
+      data->warm_fb = NULL;
+    }
+
+  if (opt_prewarm_effects)
+    {
+      for (i = 0; i < N_EFFECTS; i++)
+        if (data->prewarmed_data[i])
+          {
+            effects[i]->fini (data->prewarmed_data[i]);
+            data->prewarmed_data[i] = NULL;
+          }
+    }
+  else if (data->current_effect)
+    {
+      data->current_effect->fini (data->effect_data);
+    }
+
+  data->current_effect = NULL;
+}
+
+static void
+set_effect (Data *data,
+            const Effect *effect)
+{
+  int i;
+
+  for (i = 0; i < N_EFFECTS; i++)
+    if (effects[i] == effect)
+      break;
+
+  if (opt_prewarm_effects)
+    {
+      /* The effect was initialised at startup so switching is just a
+       * matter of changing the pointers */
+      effect_set_up_sink (effect, data->sink);
+      data->effect_data = data->prewarmed_data[i];
+    }
+  else
+    {
+      clear_effect (data);
+      effect_set_up_sink (effect, data->sink);
+      data->effect_data = effect->init (data->context, data->sink);
+    }
+
+  data->current_effect = effect;
+
+  data->current_effect_num = i;
+
+  /* The old frames were recorded with the previous effect's layers */
+  if (data->frame_history)
+    frame_history_clear (data->frame_history);
+
+  /* If the pipeline is already ready then we can immediately set it
+   * up and show the effect on the current frame */
+  if (cogl_gst_video_sink_is_ready (data->sink))
+    {
+      effect->set_up_pipeline (data->sink, data->effect_data);
+      frame_scheduler_queue_repaint (data->scheduler);
+    }
+}
+
+static gboolean
+process_arguments (int *argc,
+                   char ***argv,
+                   GError **error)
+{
+  GOptionContext *context;
+  gboolean ret;
+  GOptionGroup *group, *gst_group;
+
+  group = g_option_group_new (NULL, /* name */
+                              NULL, /* description */
+                              NULL, /* help_description */
+                              NULL, /* user_data */
+                              NULL /* destroy notify */);
+  g_option_group_add_entries (group, main_options);
+  context = g_option_context_new ("- A sample video player with effects");
+  g_option_context_set_main_group (context, group);
+
+  gst_group = gst_init_get_option_group ();
+  g_option_context_add_group (context, gst_group);
+
+  ret = g_option_context_parse (context, argc, argv, error);
+
+  g_option_context_free (context);
+
+  if (ret && *argc > 1)
+    {
+      g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_UNKNOWN_OPTION,
+                   "Unknown option '%s'", (* argv)[1]);
+      ret = FALSE;
+    }
+
+  return ret;
+}
+
+static void
+request_effect (Data *data,
+                int effect_num)
+{
+  data->requested_effect_num = effect_num;
+  channel_send (data->to_render,
+                MESSAGE_EFFECT_SWITCH_STARTED,
+                g_get_monotonic_time () * 1000);
+  channel_send (data->to_render, MESSAGE_SET_EFFECT, effect_num);
+}
+
+static void
+set_rate (Data *data,
+          int rate_num)
+{
+  GstSeekFlags flags;
+  gint64 position;
+  int old_rate_num = data->rate_num;
+
+  if (rate_num < 0 ||
+      rate_num >= STATS_N_RATES ||
+      rate_num == old_rate_num ||
+      !gst_element_query_position (data->pipeline,
+                                   GST_FORMAT_TIME,
+                                   &position))
+    return;
+
+  data->rate_num = rate_num;
+
+  /* Keep looping gaplessly at the new rate */
+  flags = GST_SEEK_FLAG_FLUSH | get_trick_mode_flags (data);
+  if (data->segment_seek_done)
+    flags |= GST_SEEK_FLAG_SEGMENT;
+
+  if (gst_element_seek (data->pipeline,
+                        get_rate (data),
+                        GST_FORMAT_TIME,
+                        flags,
+                        GST_SEEK_TYPE_SET, position,
+                        GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE))
+    {
+      channel_send (data->to_render, MESSAGE_SET_RATE, rate_num);
+      channel_send (data->to_render, MESSAGE_SEEK_STARTED, 0);
+    }
+  else
+    {
+      data->rate_num = old_rate_num;
+    }
+}
+
+static void
+seek_relative (Data *data,
+               int seconds)
+{
+  int64_t start_time = g_get_monotonic_time () * 1000;
+  GstSeekFlags flags;
+  gint64 position;
+
+  if (!gst_element_query_position (data->pipeline,
+                                   GST_FORMAT_TIME,
+                                   &position))
+    return;
+
+  position = MAX (position + seconds * GST_SECOND, 0);
+
+  /* Scrubbing only needs to land on the nearest keyframe so there is
+   * no need to decode up to the exact position */
+  flags = (GST_SEEK_FLAG_FLUSH |
+           GST_SEEK_FLAG_KEY_UNIT |
+           GST_SEEK_FLAG_SNAP_NEAREST |
+           get_trick_mode_flags (data));
+  if (data->segment_seek_done)
+    flags |= GST_SEEK_FLAG_SEGMENT;
+
+  if (gst_element_seek (data->pipeline,
+                        get_rate (data),
+                        GST_FORMAT_TIME,
+                        flags,
+                        GST_SEEK_TYPE_SET, position,
+                        GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE))
+    channel_send (data->to_render, MESSAGE_SEEK_STARTED, start_time);
+}
+
+static void
+set_paused (Data *data,
+            bool paused)
+{
+  if (gst_element_set_state (data->pipeline,
+                             paused ? GST_STATE_PAUSED : GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE)
+    data->paused = paused;
+}
+
+static void
+step_frame (Data *data,
+            int direction)
+{
+  /* Stepping only makes sense while paused */
+  if (!data->paused)
+    set_paused (data, true);
+
+  /* The render thread decides whether it can use its frame
+   * history */
+  channel_send (data->to_render, MESSAGE_STEP, direction);
+}
+
+static void
+handle_key_press (Data *data,
+                  int keysym)
+{
+  if (keysym >= SDLK_0 && keysym <= SDLK_9)
+    {
+      int effect_num = keysym - SDLK_0;
+
+      if (effect_num < N_EFFECTS)
+        request_effect (data, effect_num);
+    }
+  else if (keysym == SDLK_EQUALS ||
+           keysym == SDLK_PLUS ||
+           keysym == SDLK_KP_PLUS)
+    {
+      set_rate (data, data->rate_num + 1);
+    }
+  else if (keysym == SDLK_MINUS ||
+           keysym == SDLK_KP_MINUS)
+    {
+      set_rate (data, data->rate_num - 1);
+    }
+  else if (keysym == SDLK_LEFT || keysym == SDLK_RIGHT)
+    {
+      seek_relative (data,
+                     keysym == SDLK_LEFT ?
+                     -SEEK_STEP_SECONDS :
+                     SEEK_STEP_SECONDS);
+    }
+  else if (keysym == SDLK_COMMA || keysym == SDLK_PERIOD)
+    {
+      step_frame (data, keysym == SDLK_COMMA ? -1 : 1);
+    }
+  else if (keysym == SDLK_SPACE)
+    {
+      set_paused (data, !data->paused);
+    }
+}
+
+static void
+control_message_cb (const ChannelMessage *message,
+                    void *user_data)
+{
+  Data *data = user_data;
+
+  switch ((MessageType) message->type)
+    {
+    case MESSAGE_KEY_PRESS:
+      handle_key_press (data, message->value);
+      break;
+
+    case MESSAGE_STEP_PIPELINE:
+      gst_element_send_event (data->pipeline,
+                              gst_event_new_step (GST_FORMAT_BUFFERS,
+                                                  message->value,
+                                                  1.0, /* rate */
+                                                  TRUE, /* flush */
+                                                  FALSE /* intermediate */));
+      break;
+
+    case MESSAGE_COMMAND_DONE:
+      if (data->pending_request && message->tag == data->command_serial)
+        {
+          control_request_reply (data->pending_request,
+                                 "OK first_frame_ms=%.3f",
+                                 message->value / 1e6);
+          finish_pending_request (data);
+        }
+      break;
+
+    default:
+      g_warn_if_reached ();
+      break;
+    }
+}
+
+static void
+step_history (Data *data,
+              int direction)
+{
+  bool stepped = false;
+
+  if (data->frame_history)
+    stepped = (direction < 0 ?
+               frame_history_step_back (data->frame_history) :
+               frame_history_step_forward (data->frame_history));
+
+  if (stepped)
+    frame_scheduler_queue_repaint (data->scheduler);
+  else if (direction > 0)
+    /* The next frame has to come from the pipeline. Stepping
+     * backwards past the oldest frame isn't supported */
+    channel_send (data->to_control, MESSAGE_STEP_PIPELINE, direction);
+}
+
+static void
+render_message_cb (const ChannelMessage *message,
+                   void *user_data)
+{
+  Data *data = user_data;
+
+  switch ((MessageType) message->type)
+    {
+    case MESSAGE_EFFECT_SWITCH_STARTED:
+      data->effect_switch_time = message->value;
+      break;
+
+    case MESSAGE_SET_EFFECT:
+      set_effect (data, effects[message->value]);
+      break;
+
+    case MESSAGE_DUPLICATE_FRAME:
+      duplicate_frame_arrived (data, message->value);
+      break;
+
+    case MESSAGE_LOOP:
+      data->stats.loops++;
+      histogram_add (data->stats.loop_gap, message->value);
+      break;
+
+    case MESSAGE_SET_RATE:
+      {
+        const StatsRate *rate = data->stats.rates + data->stats.rate;
+        int old_rate = data->stats.rate;
+
+        stats_set_rate (&data->stats, message->value);
+
+        if (!opt_json && rate->time > 0)
+          g_print ("%ix: %.1f fps decoded, %.1f fps painted\n",
+                   1 << old_rate,
+                   rate->frames_decoded * 1e6 / rate->time,
+                   rate->frames_painted * 1e6 / rate->time);
+      }
+      break;
+
+    case MESSAGE_SEEK_STARTED:
+      /* The old frames aren't next to the new ones anymore */
+      if (data->frame_history)
+        frame_history_clear (data->frame_history);
+      data->seek_start_time = message->value;
+      break;
+
+    case MESSAGE_STEP:
+      step_history (data, message->value);
+      break;
+
+    case MESSAGE_WAIT_FOR_PAINT:
+    case MESSAGE_WAIT_FOR_FRAME:
+      data->command_start_time = message->value;
+      data->command_tag = message->tag;
+      data->command_needs_new_frame =
+        message->type == MESSAGE_WAIT_FOR_FRAME;
+      break;
+
+    default:
+      g_warn_if_reached ();
+      break;
+    }
+}
+
+static void *
+control_thread_func (void *user_data)
+{
+  Data *data = user_data;
+
+  trace_set_thread_name ("control");
+
+  g_main_context_push_thread_default (data->control_context);
+  g_main_loop_run (data->control_loop);
+  g_main_context_pop_thread_default (data->control_context);
+
+  return NULL;
+}
+
+static void
+set_up_render_thread (void)
+{
+  int ret;
+
+  if (opt_realtime)
+    {
+      struct sched_param param;
+
+      memset (&param, 0, sizeof (param));
+      param.sched_priority = REALTIME_PRIORITY;
+
+      ret = pthread_setschedparam (pthread_self (), SCHED_FIFO, &param);
+
+      if (ret)
+        fprintf (stderr,
+                 "Failed to set real-time priority: %s\n",
+                 strerror (ret));
+    }
+
+  if (opt_render_cpu >= 0)
+    {
+      cpu_set_t cpus;
+
+      CPU_ZERO (&cpus);
+      CPU_SET (opt_render_cpu, &cpus);
+
+      ret = pthread_setaffinity_np (pthread_self (), sizeof (cpus), &cpus);
+
+      if (ret)
+        fprintf (stderr,
+                 "Failed to pin the render thread to CPU %i: %s\n",
+                 opt_render_cpu,
+                 strerror (ret));
+    }
+}
+
+static gboolean
+sdl_event_cb (void *user_data)
+{
+  Data *data = user_data;
+  SDL_Event event;
+  int64_t trace_start = trace_begin ();
+
+  while (SDL_PollEvent (&event))
+    {
+      switch (event.type)
+        {
+        case SDL_KEYDOWN:
+          channel_send (data->to_control,
+                        MESSAGE_KEY_PRESS,
+                        event.key.keysym.sym);
+          break;
+
+        case SDL_WINDOWEVENT:
+          switch (event.window.event)
+            {
+            case SDL_WINDOWEVENT_CLOSE:
+              g_main_quit (data->main_loop);
+              break;
+            }
+          break;
+
+        case SDL_QUIT:
+          g_main_quit (data->main_loop);
+          break;
+
+        default:
+          break;
+        }
+
+      cogl_sdl_handle_event (data->context, &event);
+    }
+
+  trace_end ("sdl-events", trace_start);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static CoglOnscreen *
+create_onscreen (Data *data)
+{
+  CoglOnscreen *onscreen;
+
+  onscreen = cogl_onscreen_new (data->context, opt_width, opt_height);
+  cogl_onscreen_set_resizable (onscreen, TRUE);
+  cogl_onscreen_add_resize_callback (onscreen, resize_callback, data, NULL);
+  cogl_framebuffer_allocate (COGL_FRAMEBUFFER (onscreen), NULL);
+
+  return onscreen;
+}
+
+static CoglOffscreen *
+create_offscreen (Data *data)
+{
+  CoglTexture2D *texture;
+  CoglOffscreen *offscreen;
+
+  texture = cogl_texture_2d_new_with_size (data->context,
+                                           opt_width, opt_height,
+                                           COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                           NULL /* error */);
+  if (texture == NULL)
+    return NULL;
+
+  offscreen = cogl_offscreen_new_with_texture (COGL_TEXTURE (texture));
+  cogl_object_unref (texture);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), NULL))
+    {
+      cogl_object_unref (offscreen);
+      return NULL;
+    }
+
+  return offscreen;
+}
+
+static gboolean
+update_rates_cb (void *user_data)
+{
+  Data *data = user_data;
+  int64_t now = g_get_monotonic_time ();
+  int frames_painted = data->stats.frames_painted;
+  int frames_decoded = g_atomic_int_get (&data->stats.frames_decoded);
+
+  if (data->last_rate_time)
+    {
+      double elapsed = (now - data->last_rate_time) / 1e6;
+
+      data->painted_fps =
+        (frames_painted - data->last_frames_painted) / elapsed;
+      data->decoded_fps =
+        (frames_decoded - data->last_frames_decoded) / elapsed;
+    }
+
+  data->last_rate_time = now;
+  data->last_frames_painted = frames_painted;
+  data->last_frames_decoded = frames_decoded;
+
+  return G_SOURCE_CONTINUE;
+}
+
+static uint64_t
+get_video_texture_size (Data *data)
+{
+  GstPad *pad = gst_element_get_static_pad (GST_ELEMENT (data->sink),
+                                            "sink");
+  GstCaps *caps = gst_pad_get_current_caps (pad);
+  GstVideoInfo info;
+  uint64_t size = 0;
+
+  /* The sink uploads every plane of the frame into its own texture
+   * so the size of the raw frame is a good estimate of the texture
+   * memory */
+  if (caps)
+    {
+      if (gst_video_info_from_caps (&info, caps))
+        size = GST_VIDEO_INFO_SIZE (&info);
+
+      gst_caps_unref (caps);
+    }
+
+  gst_object_unref (pad);
+
+  return size;
+}
+
+static void
+write_metrics (GString *out,
+               void *user_data)
+{
+  Data *data = user_data;
+
+  metrics_add_info (out,
+                    "effect",
+                    "The currently selected effect",
+                    "name",
+                    data->current_effect->name);
+  metrics_add_gauge (out,
+                     "rendered_fps",
+                     "Frames painted in the last second",
+                     data->painted_fps);
+  metrics_add_gauge (out,
+                     "decoded_fps",
+                     "Frames received from the decoder in the last second",
+                     data->decoded_fps);
+  metrics_add_counter (out,
+                       "frames_painted_total",
+                       "Frames painted",
+                       data->stats.frames_painted);
+  metrics_add_counter (out,
+                       "frames_decoded_total",
+                       "Frames received from the decoder",
+                       g_atomic_int_get (&data->stats.frames_decoded));
+  metrics_add_counter (out,
+                       "frames_dropped_total",
+                       "Frames replaced by a newer one before being painted",
+                       data->stats.frames_dropped);
+  metrics_add_counter (out,
+                       "frames_painted_late_total",
+                       "Frames painted after the vblank they were meant for",
+                       data->stats.frames_painted_late);
+  metrics_add_counter (out,
+                       "frames_duplicate_total",
+                       "Frames not uploaded because they matched the last one",
+                       data->stats.frames_duplicate);
+  metrics_add_counter (out,
+                       "repaints_skipped_total",
+                       "Duplicate frames that didn't need to be repainted",
+                       data->stats.repaints_skipped);
+  metrics_add_counter (out,
+                       "loops_total",
+                       "Times the video has looped back to the start",
+                       data->stats.loops);
+  metrics_add_summary (out,
+                       "effect_switch_latency_seconds",
+                       "Time from an effect switch being requested to the "
+                       "first frame painted with it",
+                       data->stats.effect_switch_latency);
+  metrics_add_summary (out,
+                       "seek_latency_seconds",
+                       "Time from a seek to the first frame after it being "
+                       "painted",
+                       data->stats.seek_latency);
+  metrics_add_summary (out,
+                       "loop_gap_seconds",
+                       "Time between the last frame of a loop and the first "
+                       "frame of the next reaching the sink",
+                       data->stats.loop_gap);
+  metrics_add_gauge (out,
+                     "frame_queue_depth",
+                     "Frames waiting in the queue for the renderer",
+                     frame_queue_get_depth (data->frame_queue));
+  metrics_add_counter (out,
+                       "frame_queue_overflows_total",
+                       "Frames that arrived while the queue was full",
+                       frame_queue_get_n_overflows (data->frame_queue));
+  metrics_add_summary (out,
+                       "frame_queue_latency_seconds",
+                       "Time from a frame reaching the sink to being painted",
+                       data->stats.queue_latency);
+  metrics_add_summary (out,
+                       "glass_to_glass_latency_seconds",
+                       "Time from a live source capturing a frame to it "
+                       "being presented",
+                       data->stats.glass_latency);
+  metrics_add_summary (out,
+                       "command_latency_seconds",
+                       "Time from a control command to the first frame "
+                       "painted with its effect",
+                       data->stats.command_latency);
+  metrics_add_summary (out,
+                       "paint_seconds",
+                       "Time taken to paint a frame",
+                       data->stats.paint_time);
+  metrics_add_counter (out,
+                       "bus_errors_total",
+                       "Error messages from the GStreamer pipeline",
+                       g_atomic_int_get (&data->stats.bus_errors));
+  metrics_add_gauge (out,
+                     "video_texture_bytes",
+                     "Estimated texture memory used for the video frame",
+                     get_video_texture_size (data));
+}
+
+/* Returns the number of the effect or -1 if there isn't one */
+static int
+find_effect (const char *name)
+{
+  char *end;
+  long effect_num;
+  int i;
+
+  effect_num = strtol (name, &end, 10);
+
+  if (end != name && *end == '\0')
+    {
+      if (effect_num >= 0 && effect_num < N_EFFECTS)
+        return effect_num;
+      else
+        return -1;
+    }
+
+  for (i = 0; i < N_EFFECTS; i++)
+    if (!g_ascii_strcasecmp (effects[i]->name, name))
+      return i;
+
+  return -1;
+}
+
+static GstElement *
+create_video_sink (Data *data)
+{
+  GstElement *sink;
+
+  if (opt_decode_only)
+    {
+      sink = gst_element_factory_make ("fakesink", NULL);
+      g_object_set (sink,
+                    "sync", FALSE,
+                    "signal-handoffs", TRUE,
+                    NULL);
+      g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), data);
+    }
+  else
+    {
+      sink = GST_ELEMENT (data->sink);
+
+      if (opt_uncapped)
+        g_object_set (sink, "sync", FALSE, NULL);
+    }
+
+  return sink;
+}
+
+static void
+add_test_source (GstElement *pipeline,
+                 GstElement *video_sink)
+{
+  GstElement *src, *filter;
+  GstCaps *caps;
+
+  src = gst_element_factory_make ("videotestsrc", NULL);
+  /* Use a moving pattern so that every frame is different */
+  gst_util_set_object_arg (G_OBJECT (src), "pattern", "ball");
+  /* A live source timestamps each frame with when it was generated
+   * so it can stand in for a camera */
+  g_object_set (src, "is-live", opt_live, NULL);
+
+  caps = gst_caps_new_simple ("video/x-raw",
+                              "width", G_TYPE_INT, opt_test_width,
+                              "height", G_TYPE_INT, opt_test_height,
+                              "framerate", GST_TYPE_FRACTION, 60, 1,
+                              NULL);
+  filter = gst_element_factory_make ("capsfilter", NULL);
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, filter, video_sink, NULL);
+  gst_element_link_many (src, filter, video_sink, NULL);
+}
+
+static void
+set_up_live_mode (Data *data,
+                  GstElement *pipeline)
+{
+  /* QoS events let the source and decoders skip frames that would be
+   * late anyway instead of letting the delay build up */
+  if (!opt_decode_only)
+    g_object_set (data->sink, "qos", TRUE, NULL);
+
+  if (opt_latency >= 0)
+    gst_pipeline_set_latency (GST_PIPELINE (pipeline),
+                              opt_latency * GST_MSECOND);
+
+  /* Buffering would only add latency for a live stream */
+  if (data->playbin)
+    {
+      int flags;
+
+      g_object_get (data->playbin, "flags", &flags, NULL);
+      g_object_set (data->playbin,
+                    "flags", flags & ~PLAY_FLAG_BUFFERING,
+                    NULL);
+    }
+}
+
+static gboolean
+add_image_source (Data *data,
+                  GstElement *pipeline,
+                  GstElement *video_sink,
+                  GError **error)
+{
+  GstElement *src;
+
+  data->image_sequence = image_sequence_new (opt_video_file,
+                                             opt_frame_rate,
+                                             error);
+
+  if (data->image_sequence == NULL)
+    return FALSE;
+
+  src = gst_element_factory_make ("appsrc", NULL);
+  image_sequence_attach (data->image_sequence, GST_APP_SRC (src));
+
+  gst_bin_add_many (GST_BIN (pipeline), src, video_sink, NULL);
+  gst_element_link (src, video_sink);
+
+  return TRUE;
+}
+
+static void
+print_stats (Data *data)
+{
+  const char *mode;
+  char *mode_str, *input;
+
+  if (!opt_decode_only)
+    {
+      GstStructure *sink_stats;
+      guint64 dropped;
+
+      g_object_get (data->sink, "stats", &sink_stats, NULL);
+
+      if (gst_structure_get_uint64 (sink_stats, "dropped", &dropped))
+        data->stats.frames_late = dropped;
+
+      gst_structure_free (sink_stats);
+    }
+
+  if (data->stats.end_time == 0)
+    data->stats.end_time = g_get_monotonic_time ();
+
+  /* Count the frames at the current rate */
+  stats_set_rate (&data->stats, data->stats.rate);
+
+  if (opt_decode_only)
+    mode = "decode-only";
+  else if (data->headless)
+    mode = "headless";
+  else
+    mode = "onscreen";
+
+  mode_str = g_strconcat (mode,
+                          opt_uncapped ? "-uncapped" : "",
+                          data->uploader ? "-async-upload" : "",
+                          opt_live ? "-live" : "",
+                          NULL);
+
+  if (opt_video_type == VIDEO_TYPE_TEST)
+    input = g_strdup_printf ("videotestsrc %ix%i",
+                             opt_test_width,
+                             opt_test_height);
+  else if (opt_video_type == VIDEO_TYPE_PLAYLIST)
+    input = g_strdup_printf ("playlist %s", opt_video_file);
+  else if (opt_video_type == VIDEO_TYPE_IMAGES)
+    input = g_strdup_printf ("images %s", opt_video_file);
+  else
+    input = g_strdup (opt_video_file);
+
+  stats_write_json (&data->stats,
+                    stdout,
+                    opt_decode_only ? "" : data->current_effect->name,
+                    input,
+                    mode_str);
+
+  g_free (input);
+  g_free (mode_str);
+}
+
+static gboolean
+pending_request_timeout_cb (void *user_data)
+{
+  Data *data = user_data;
+
+  fail_pending_request (data, "Timed out waiting for a frame");
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+wait_for_first_frame (Data *data,
+                      ControlRequest *request,
+                      MessageType type,
+                      int64_t start_time)
+{
+  /* The reply is sent from control_message_cb once the frame has
+   * been painted */
+  data->pending_request = request;
+  channel_send_tagged (data->to_render,
+                       type,
+                       ++data->command_serial,
+                       start_time);
+
+  data->pending_timeout =
+    g_timeout_source_new_seconds (COMMAND_TIMEOUT_SECONDS);
+  g_source_set_callback (data->pending_timeout,
+                         pending_request_timeout_cb,
+                         data,
+                         NULL /* notify */);
+  g_source_attach (data->pending_timeout, data->control_context);
+}
+
+static gboolean
+load_video (Data *data,
+            const char *input)
+{
+  char *uri = get_uri (input);
+
+  gst_element_set_state (data->pipeline, GST_STATE_READY);
+
+  /* The streaming threads have stopped so their state can be reset */
+  frame_queue_discard (data->frame_queue);
+  if (data->loop_cache)
+    loop_cache_reset (data->loop_cache);
+  data->segment_seek_done = FALSE;
+  g_atomic_int_set (&data->loop_seek_pending, FALSE);
+
+  data->paused = FALSE;
+  channel_send (data->to_render, MESSAGE_SEEK_STARTED, 0);
+
+  /* The new video starts at normal speed */
+  if (data->rate_num != 0)
+    {
+      data->rate_num = 0;
+      channel_send (data->to_render, MESSAGE_SET_RATE, 0);
+    }
+
+  g_object_set (data->playbin, "uri", uri, NULL);
+  g_free (uri);
+
+  return (gst_element_set_state (data->pipeline, GST_STATE_PLAYING) !=
+          GST_STATE_CHANGE_FAILURE);
+}
+
+static gboolean
+seek_video (Data *data,
+            const char *args,
+            int64_t start_time)
+{
+  GstSeekFlags flags = GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE;
+  double seconds;
+  char *end;
+
+  /* An accurate seek would defeat the keyframe-only trick mode */
+  if (data->rate_num > 0)
+    flags = GST_SEEK_FLAG_FLUSH | get_trick_mode_flags (data);
+
+  seconds = g_ascii_strtod (args, &end);
+
+  if (end == args || *end != '\0' || seconds < 0.0)
+    return FALSE;
+
+  /* Keep looping gaplessly after the seek */
+  if (data->segment_seek_done)
+    flags |= GST_SEEK_FLAG_SEGMENT;
+
+  if (!gst_element_seek (data->pipeline,
+                         get_rate (data),
+                         GST_FORMAT_TIME,
+                         flags,
+                         GST_SEEK_TYPE_SET, seconds * GST_SECOND,
+                         GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE))
+    return FALSE;
+
+  channel_send (data->to_render, MESSAGE_SEEK_STARTED, start_time);
+
+  return TRUE;
+}
+
+static void
+reply_status (Data *data,
+              ControlRequest *request)
+{
+  GstState state;
+  gint64 position = 0, duration = 0;
+  char *uri = NULL;
+
+  gst_element_get_state (data->pipeline, &state, NULL, 0);
+  gst_element_query_position (data->pipeline, GST_FORMAT_TIME, &position);
+  gst_element_query_duration (data->pipeline, GST_FORMAT_TIME, &duration);
+
+  if (data->playbin)
+    g_object_get (data->playbin, "current-uri", &uri, NULL);
+
+  control_request_reply (request,
+                         "OK state=%s position=%.3f duration=%.3f "
+                         "effect=%s uri=%s",
+                         gst_element_state_get_name (state),
+                         position / (double) GST_SECOND,
+                         duration / (double) GST_SECOND,
+                         effects[data->requested_effect_num]->name,
+                         uri ? uri : "none");
+
+  g_free (uri);
+}
+
+static void
+command_cb (ControlRequest *request,
+            const char *command,
+            const char *args,
+            void *user_data)
+{
+  Data *data = user_data;
+  int64_t start_time = g_get_monotonic_time () * 1000;
+
+  /* Only one command at a time can wait for its first frame so that
+   * the latency is reported against the right one */
+  if (data->pending_request)
+    {
+      control_request_reply (request, "ERROR Busy");
+    }
+  else if (!strcmp (command, "load"))
+    {
+      if (data->playbin == NULL || *args == '\0')
+        control_request_reply (request, "ERROR Can't load a video");
+      else if (!load_video (data, args))
+        control_request_reply (request, "ERROR Failed to load '%s'", args);
+      else
+        wait_for_first_frame (data,
+                              request,
+                              MESSAGE_WAIT_FOR_FRAME,
+                              start_time);
+    }
+  else if (!strcmp (command, "effect"))
+    {
+      int effect_num = find_effect (args);
+
+      if (effect_num == -1)
+        {
+          control_request_reply (request, "ERROR Unknown effect '%s'", args);
+        }
+      else
+        {
+          /* The render thread has to be waiting before the effect
+           * changes so that the paint for the switch is the one that
+           * gets measured */
+          wait_for_first_frame (data,
+                                request,
+                                MESSAGE_WAIT_FOR_PAINT,
+                                start_time);
+          request_effect (data, effect_num);
+        }
+    }
+  else if (!strcmp (command, "seek"))
+    {
+      if (seek_video (data, args, start_time))
+        wait_for_first_frame (data,
+                              request,
+                              MESSAGE_WAIT_FOR_FRAME,
+                              start_time);
+      else
+        control_request_reply (request, "ERROR Failed to seek to '%s'", args);
+    }
+  else if (!strcmp (command, "pause") || !strcmp (command, "play"))
+    {
+      bool paused = !strcmp (command, "pause");
+
+      set_paused (data, paused);
+
+      if (data->paused != paused)
+        control_request_reply (request, "ERROR Failed to %s", command);
+      else
+        control_request_reply (request, "OK");
+    }
+  else if (!strcmp (command, "status"))
+    {
+      reply_status (data, request);
+    }
+  else
+    {
+      control_request_reply (request, "ERROR Unknown command '%s'", command);
+    }
+}
+
+/* Cogl doesn't give access to its GL programs so it isn't possible
+ * to save their binaries ourselves. Instead this sets up the disk
+ * caches that Mesa and the NVIDIA driver have built in. They are
+ * keyed on the generated source and the driver build so they are
+ * safe to share between video formats. This has to be done before
+ * the GL context is created */
+static void
+set_up_shader_cache (void)
+{
+  char *dir;
+
+  if (!opt_shader_cache)
+    {
+      g_setenv ("MESA_SHADER_CACHE_DISABLE", "true", TRUE);
+      g_setenv ("MESA_GLSL_CACHE_DISABLE", "true", TRUE);
+      g_setenv ("__GL_SHADER_DISK_CACHE", "0", TRUE);
+      return;
+    }
+
+  if (opt_shader_cache_dir)
+    dir = g_strdup (opt_shader_cache_dir);
+  else
+    dir = g_build_filename (g_get_user_cache_dir (),
+                            "sprite-player",
+                            "shaders",
+                            NULL);
+
+  if (g_mkdir_with_parents (dir, 0700) == -1)
+    {
+      fprintf (stderr, "%s: %s\n", dir, strerror (errno));
+    }
+  else
+    {
+      /* The default directory doesn't override one that the user
+       * has already set in the environment */
+      g_setenv ("MESA_SHADER_CACHE_DIR", dir, opt_shader_cache_dir != NULL);
+      g_setenv ("__GL_SHADER_DISK_CACHE_PATH",
+                dir,
+                opt_shader_cache_dir != NULL);
+    }
+
+  /* Older versions of Mesa have the cache disabled by default */
+  g_setenv ("MESA_SHADER_CACHE_DISABLE", "false", FALSE);
+  g_setenv ("MESA_GLSL_CACHE_DISABLE", "false", FALSE);
+  g_setenv ("__GL_SHADER_DISK_CACHE", "1", FALSE);
+
+  g_free (dir);
+}
+
+static int
+generate_contact_sheet (CoglContext *context,
+                        const Effect *effect)
+{
+  GError *error = NULL;
+  char *uri;
+  bool ret;
+
+  if (opt_video_type == VIDEO_TYPE_NONE)
+    {
+      fprintf (stderr, "--contact-sheet needs a video file\n");
+      return 1;
+    }
+
+  if (opt_video_type != VIDEO_TYPE_FILE)
+    {
+      fprintf (stderr,
+               "--contact-sheet can only be used with a single file\n");
+      return 1;
+    }
+
+  if (opt_width < opt_contact_sheet_columns ||
+      opt_height < opt_contact_sheet_rows)
+    {
+      fprintf (stderr, "The contact sheet is too small for the grid\n");
+      return 1;
+    }
+
+  uri = get_uri (opt_video_file);
+
+  ret = contact_sheet_generate (context,
+                                uri,
+                                effect,
+                                opt_contact_sheet_columns,
+                                opt_contact_sheet_rows,
+                                opt_width, opt_height,
+                                opt_contact_sheet_output,
+                                &error);
+
+  g_free (uri);
+
+  if (!ret)
+    {
+      fprintf (stderr, "%s\n", error->message);
+      g_clear_error (&error);
+      return 1;
+    }
+
+  return 0;
+}
+
+int
+main (int argc,
+      char **argv)
 {
   Data data;
   CoglContext *ctx;
-  CoglOnscreen *onscreen;
-  GstElement *pipeline;
+  CoglOnscreen *onscreen = NULL;
+  GstElement *pipeline, *video_sink;
+  const Effect *effect = effects[1];
+  int effect_num;
   GSource *cogl_source;
   GError *error = NULL;
   GstBus *bus;
-  guint event_timeout_source;
+  GSource *bus_source;
+  GSource *sdl_source = NULL;
+  guint rates_source = 0;
+  MetricsServer *metrics_server = NULL;
   int i;
 
   if (!process_arguments (&argc, &argv, &error))
@@ -377,20 +2728,108 @@ main (int argc,
       return 1;
     }
 
+  if (opt_swap_interval < 0)
+    {
+      fprintf (stderr, "The swap interval can't be negative\n");
+      return 1;
+    }
+
+  if (opt_frame_rate <= 0)
+    {
+      fprintf (stderr, "The frame rate must be positive\n");
+      return 1;
+    }
+
+  if (opt_list_effects)
+    {
+      for (i = 0; i < N_EFFECTS; i++)
+        g_print ("%s\n", effects[i]->name);
+      return 0;
+    }
+
+  if (opt_effect)
+    {
+      effect_num = find_effect (opt_effect);
+
+      if (effect_num == -1)
+        {
+          fprintf (stderr, "Unknown effect '%s'\n", opt_effect);
+          return 1;
+        }
+
+      effect = effects[effect_num];
+    }
+
+  if (opt_trace_file)
+    {
+      trace_enable ();
+      trace_set_thread_name ("main");
+    }
+
   memset (&data, 0, sizeof (Data));
 
+  stats_init (&data.stats);
+
+  set_up_shader_cache ();
+
   /* Set the necessary cogl elements */
 
   data.context = ctx = cogl_sdl_context_new (SDL_USEREVENT, NULL);
 
-  onscreen = create_onscreen (&data);
+  if (opt_contact_sheet_columns > 0)
+    return generate_contact_sheet (ctx, opt_effect ? effect : effects[0]);
+
+  data.headless = opt_headless;
+
+  data.scheduler = frame_scheduler_new (!data.headless,
+                                        &data.stats,
+                                        paint_cb,
+                                        &data);
+  frame_scheduler_set_swap_interval (data.scheduler,
+                                     opt_uncapped ? 0 : opt_swap_interval);
+
+  if (data.headless)
+    {
+      CoglOffscreen *offscreen = create_offscreen (&data);
+
+      if (offscreen == NULL)
+        {
+          fprintf (stderr, "Failed to create the offscreen framebuffer\n");
+          return 1;
+        }
+
+      data.fb = COGL_FRAMEBUFFER (offscreen);
+
+      if (opt_dump_dir && g_mkdir_with_parents (opt_dump_dir, 0777) == -1)
+        {
+          fprintf (stderr, "%s: %s\n", opt_dump_dir, strerror (errno));
+          return 1;
+        }
+    }
+  else
+    {
+      onscreen = create_onscreen (&data);
+      data.fb = COGL_FRAMEBUFFER (onscreen);
+    }
+
+  if (opt_gpu_timing)
+    {
+      data.gpu_timer = gpu_timer_new ();
 
-  data.fb = COGL_FRAMEBUFFER (onscreen);
+      if (data.gpu_timer == NULL)
+        fprintf (stderr,
+                 "GL_ARB_timer_query is not supported so GPU timing "
+                 "is disabled\n");
+    }
 
   data.sink = cogl_gst_video_sink_new (ctx);
 
-  pipeline = gst_pipeline_new ("gst-player");
-  data.playbin = gst_element_factory_make ("playbin", "bin");
+  /* The main loop is created before the pipeline is started because
+   * in decode-only mode it can be quit from the streaming thread */
+  data.main_loop = g_main_loop_new (NULL, FALSE);
+
+  data.pipeline = pipeline = gst_pipeline_new ("gst-player");
+  video_sink = create_video_sink (&data);
 
   if (opt_video_type == VIDEO_TYPE_NONE)
     {
@@ -399,72 +2838,325 @@ main (int argc,
       opt_video_type = VIDEO_TYPE_FILE;
     }
 
-  g_object_set (G_OBJECT (data.playbin),
-                "video-sink", GST_ELEMENT (data.sink),
-                NULL);
+  if (opt_video_type == VIDEO_TYPE_TEST)
+    {
+      add_test_source (pipeline, video_sink);
+    }
+  else if (opt_video_type == VIDEO_TYPE_IMAGES)
+    {
+      if (!add_image_source (&data, pipeline, video_sink, &error))
+        {
+          fprintf (stderr, "%s\n", error->message);
+          g_clear_error (&error);
+          return 1;
+        }
+    }
+  else
+    {
+      data.playbin = gst_element_factory_make ("playbin", "bin");
+
+      g_object_set (G_OBJECT (data.playbin),
+                    "video-sink", video_sink,
+                    NULL);
+
+      gst_bin_add (GST_BIN (pipeline), data.playbin);
+
+      if (opt_video_type == VIDEO_TYPE_PLAYLIST)
+        {
+          g_object_set (G_OBJECT (data.playbin),
+                        "uri", opt_playlist[0],
+                        NULL);
+          g_signal_connect (data.playbin, "about-to-finish",
+                            G_CALLBACK (about_to_finish_cb), &data);
+        }
+      else
+        {
+          char *uri = get_uri (opt_video_file);
+
+          g_object_set (G_OBJECT (data.playbin), "uri", uri, NULL);
+
+          g_free (uri);
+        }
+    }
+
+  if (opt_live)
+    set_up_live_mode (&data, pipeline);
 
-  gst_bin_add (GST_BIN (pipeline), data.playbin);
+  data.frame_queue = frame_queue_new (opt_max_queued_frames);
 
-  if (g_file_test (opt_video_file, G_FILE_TEST_EXISTS))
+  if (!opt_decode_only)
     {
-      GFile *file = g_file_new_for_path (opt_video_file);
-      char *uri = g_file_get_uri (file);
+      GstPad *pad = gst_element_get_static_pad (video_sink, "sink");
+
+      if (opt_async_upload)
+        data.uploader = texture_uploader_new (data.sink,
+                                              data.fb,
+                                              uploaded_frame_cb,
+                                              &data);
+
+      if (opt_skip_duplicates)
+        {
+          data.duplicate_detector = duplicate_detector_new ();
+          data.sink_clock = sink_clock_new (video_sink,
+                                            0 /* lead_time */);
+        }
+
+      /* Stepping backwards is only done from the keyboard */
+      if (opt_frame_history > 0 && !data.headless)
+        data.frame_history = frame_history_new (data.sink,
+                                                opt_frame_history);
+
+      /* The cache relies on the segment seeks to find the end of the
+       * first loop */
+      if (opt_loop_cache > 0 &&
+          opt_video_type == VIDEO_TYPE_FILE &&
+          opt_gapless_loop)
+        {
+          data.loop_cache = loop_cache_new ((size_t) opt_loop_cache << 20,
+                                            &error);
+
+          if (data.loop_cache == NULL)
+            {
+              fprintf (stderr, "%s\n", error->message);
+              g_clear_error (&error);
+              return 1;
+            }
+
+          g_signal_connect (data.playbin, "source-setup",
+                            G_CALLBACK (source_setup_cb), &data);
+        }
 
-      g_object_set (G_OBJECT (data.playbin), "uri", uri, NULL);
+      gst_pad_add_probe (pad,
+                         GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM |
+                         GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+                         sink_event_probe,
+                         &data,
+                         NULL /* destroy_data */);
+
+      if (opt_sink_pool)
+        gst_pad_add_probe (pad,
+                           GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM,
+                           allocation_query_probe,
+                           NULL, /* user_data */
+                           NULL /* destroy_data */);
+
+      gst_pad_add_probe (pad,
+                         GST_PAD_PROBE_TYPE_BUFFER,
+                         queue_buffer_probe,
+                         &data,
+                         NULL /* destroy_data */);
+      gst_object_unref (pad);
+    }
 
-      g_free (uri);
-      g_object_unref (file);
+  if (opt_trace_file)
+    {
+      GstPad *pad = gst_element_get_static_pad (video_sink, "sink");
+
+      gst_pad_add_probe (pad,
+                         GST_PAD_PROBE_TYPE_BUFFER,
+                         trace_buffer_probe,
+                         NULL, /* user_data */
+                         NULL /* destroy_data */);
+      gst_object_unref (pad);
     }
-  else
-    g_object_set (G_OBJECT (data.playbin), "uri", opt_video_file, NULL);
 
-  set_effect (&data, effects[1]);
+  if (opt_prewarm_effects)
+    prewarm_effects (&data);
+
+  set_effect (&data, effect);
+  data.requested_effect_num = data.current_effect_num;
+
+  data.control_context = g_main_context_new ();
+  data.control_loop = g_main_loop_new (data.control_context, FALSE);
+  data.to_control = channel_new (data.control_context,
+                                 control_message_cb,
+                                 &data);
+  data.to_render = channel_new (NULL, render_message_cb, &data);
+  data.from_streaming = channel_new (NULL, render_message_cb, &data);
 
   gst_element_set_state (pipeline, GST_STATE_PLAYING);
   bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
-  gst_bus_add_watch (bus, bus_watch, &data);
+  bus_source = gst_bus_create_watch (bus);
+  g_source_set_callback (bus_source, (GSourceFunc) bus_watch, &data, NULL);
+  g_source_attach (bus_source, data.control_context);
+  gst_object_unref (bus);
+
+  if (opt_control_socket)
+    {
+      /* The connections are handled on the control thread */
+      g_main_context_push_thread_default (data.control_context);
+      data.control_server = control_server_new (opt_control_socket,
+                                                command_cb,
+                                                &data,
+                                                &error);
+      g_main_context_pop_thread_default (data.control_context);
+
+      if (data.control_server == NULL)
+        {
+          fprintf (stderr, "%s\n", error->message);
+          g_clear_error (&error);
+          return 1;
+        }
+    }
 
-  g_print ("Press a number key to switch effect:\n");
+  data.control_thread = g_thread_new ("control", control_thread_func, &data);
 
-  for (i = 0; i < N_EFFECTS; i++)
-    g_print ("%i) %s\n", i, effects[i]->name);
+  if (!data.headless && !opt_json)
+    {
+      g_print ("Press a number key to switch effect:\n");
 
-  data.main_loop = g_main_loop_new (NULL, FALSE);
+      for (i = 0; i < N_EFFECTS; i++)
+        g_print ("%i) %s\n", i, effects[i]->name);
+
+      g_print ("Press + or - to change the playback speed\n"
+               "Press left or right to seek, space to pause and "
+               ", or . to step a frame\n");
+    }
 
   cogl_source = cogl_glib_source_new (ctx, G_PRIORITY_DEFAULT);
   g_source_attach (cogl_source, NULL);
 
-  event_timeout_source = g_timeout_add (16, event_timeout_cb, &data);
+  /* There is no window to receive events from in headless mode */
+  if (onscreen)
+    {
+      sdl_source = sdl_source_new (onscreen);
+      g_source_set_callback (sdl_source, sdl_event_cb, &data, NULL);
+      g_source_attach (sdl_source, NULL);
+    }
 
   g_signal_connect (data.sink, "pipeline-ready",
                     G_CALLBACK (set_up_pipeline), &data);
 
   g_signal_connect (data.sink, "new-frame", G_CALLBACK (new_frame_cb), &data);
 
-  cogl_onscreen_add_frame_callback (COGL_ONSCREEN (data.fb),
-                                    frame_callback,
-                                    &data,
-                                    NULL);
+  if (opt_metrics_socket)
+    {
+      metrics_server = metrics_server_new (opt_metrics_socket,
+                                           write_metrics,
+                                           &data,
+                                           &error);
+
+      if (metrics_server == NULL)
+        {
+          fprintf (stderr, "%s\n", error->message);
+          g_clear_error (&error);
+          return 1;
+        }
+
+      rates_source = g_timeout_add_seconds (1, update_rates_cb, &data);
+    }
 
-  data.draw_ready = TRUE;
-  data.frame_ready = FALSE;
+  if (onscreen)
+    cogl_onscreen_add_frame_callback (onscreen,
+                                      frame_callback,
+                                      &data,
+                                      NULL);
 
   resize_callback (onscreen,
-                   cogl_framebuffer_get_width (COGL_FRAMEBUFFER (onscreen)),
-                   cogl_framebuffer_get_height (COGL_FRAMEBUFFER (onscreen)),
+                   cogl_framebuffer_get_width (data.fb),
+                   cogl_framebuffer_get_height (data.fb),
                    &data);
-  cogl_onscreen_show (onscreen);
+
+  if (onscreen)
+    cogl_onscreen_show (onscreen);
+
+  /* This is done as late as possible because any threads created
+   * afterwards from this thread would inherit the settings */
+  set_up_render_thread ();
 
   g_main_loop_run (data.main_loop);
 
-  g_source_remove (event_timeout_source);
+  g_main_loop_quit (data.control_loop);
+  g_thread_join (data.control_thread);
+
+  g_source_destroy (bus_source);
+  g_source_unref (bus_source);
+
+  finish_pending_request (&data);
+
+  if (data.control_server)
+    control_server_free (data.control_server);
+
+  if (sdl_source)
+    {
+      g_source_destroy (sdl_source);
+      g_source_unref (sdl_source);
+    }
+
+  if (metrics_server)
+    {
+      g_source_remove (rates_source);
+      metrics_server_free (metrics_server);
+    }
+
+  if (opt_json)
+    print_stats (&data);
+
+  if (opt_trace_file && !trace_write (opt_trace_file, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      g_clear_error (&error);
+    }
+
+  if (data.gpu_timer)
+    {
+      /* Keep stdout clean for the JSON */
+      gpu_timer_print_report (data.gpu_timer, opt_json ? stderr : stdout);
+      gpu_timer_free (data.gpu_timer);
+    }
+
+  /* Stop the streaming threads before freeing anything they use. The
+   * uploader could be blocking one of them */
+  if (data.uploader)
+    texture_uploader_stop (data.uploader);
+  if (data.sink_clock)
+    sink_clock_stop (data.sink_clock);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  if (data.uploader)
+    texture_uploader_free (data.uploader);
 
   clear_effect (&data);
 
+  frame_scheduler_free (data.scheduler);
+
+  if (data.current_frame.buffer)
+    gst_buffer_unref (data.current_frame.buffer);
+  frame_queue_free (data.frame_queue);
+
+  if (data.duplicate_detector)
+    duplicate_detector_free (data.duplicate_detector);
+  if (data.sink_clock)
+    sink_clock_free (data.sink_clock);
+
+  if (data.frame_history)
+    frame_history_free (data.frame_history);
+
+  /* The appsrc's buffers point into the cache so this has to wait
+   * until the pipeline has stopped */
+  if (data.loop_cache)
+    loop_cache_free (data.loop_cache);
+
+  if (data.image_sequence)
+    image_sequence_free (data.image_sequence);
+
   g_source_destroy (cogl_source);
   g_source_unref (cogl_source);
 
+  channel_free (data.to_control);
+  channel_free (data.to_render);
+  channel_free (data.from_streaming);
+  g_main_loop_unref (data.control_loop);
+  g_main_context_unref (data.control_context);
+
   g_main_loop_unref (data.main_loop);
 
+  stats_destroy (&data.stats);
+
+  /* The pipeline and the control thread have stopped so nothing can
+   * be recording anymore */
+  trace_free ();
+
   return 0;
 }
@@ -30,43 +30,11 @@
 #include <cogl-gst/cogl-gst.h>
 
 #include "effect.h"
+#include "texture-uploader.h"
+#include "stars-sim.h"
 
 #define N_STAR_POINTS 5
 
-#define MIN_ADD_TIME 0.1f
-#define MAX_ADD_TIME 1.0f
-
-#define MIN_DRAW_SIZE 0.01f
-#define MAX_DRAW_SIZE 0.5f
-
-#define MIN_DROP_SPEED 0.1f
-#define MAX_DROP_SPEED 1.0f
-
-#define MIN_ROTATION_SPEED 0.0f
-#define MAX_ROTATION_SPEED 360.0f
-
-#define MIN_COORD_SCALE 0.01f
-#define MAX_COORD_SCALE 0.5f /* that is the whole video */
-
-#define MIN_WAVE_SIZE 0.0f
-#define MAX_WAVE_SIZE 0.5f
-
-typedef struct
-{
-  float initial_x, initial_y;
-  float drop_speed;
-  float rotation_speed;
-
-  float coord_scale[2];
-  float coord_offset[2];
-  float tint[3];
-
-  float draw_size;
-  float wave_size;
-
-  float start_time;
-} Star;
-
 typedef struct _Data
 {
   CoglContext *context;
@@ -80,121 +48,29 @@ typedef struct _Data
   int coord_scale_location;
   int coord_offset_location;
 
-  GList *stars;
+  StarsSim *sim;
 
   GTimer *timer;
-
-  float add_time;
 } Data;
 
-static void
-free_star (Data *data,
-           Star *star)
-{
-  data->stars = g_list_remove (data->stars, star);
-  g_slice_free (Star, star);
-}
-
-static void
-add_star (Data *data,
-          const CoglGstRectangle *video_output)
-{
-  Star *star = g_slice_new (Star);
-  float coord_scale;
-  float size_speed;
-  int tint_value;
-  GList *l;
-  int i;
-
-  size_speed = g_random_double ();
-
-  star->draw_size =
-    (MAX_DRAW_SIZE - MIN_DRAW_SIZE) * size_speed + MIN_DRAW_SIZE;
-
-  star->wave_size =
-    (MAX_WAVE_SIZE - MIN_WAVE_SIZE) * (1.0f - size_speed) + MIN_WAVE_SIZE;
-  if (g_random_boolean ())
-    star->wave_size = -star->wave_size;
-
-  star->initial_x = g_random_double ();
-  star->initial_y = -star->draw_size;
-
-  star->drop_speed =
-    (MAX_DROP_SPEED - MIN_DROP_SPEED) * size_speed + MIN_DROP_SPEED;
-  star->rotation_speed =
-    g_random_double_range (MIN_ROTATION_SPEED, MAX_ROTATION_SPEED);
-
-  coord_scale = g_random_double_range (MIN_COORD_SCALE, MAX_COORD_SCALE);
-
-  if (video_output->width < video_output->height)
-    {
-      star->coord_scale[0] = coord_scale;
-      star->coord_scale[1] = (coord_scale *
-                              video_output->width /
-                              video_output->height);
-    }
-  else
-    {
-      star->coord_scale[1] = coord_scale;
-      star->coord_scale[0] = (coord_scale *
-                              video_output->height /
-                              video_output->width);
-    }
-
-  star->coord_offset[0] =
-    g_random_double_range (star->coord_scale[0], 1.0f - star->coord_scale[0]);
-  star->coord_offset[1] =
-    g_random_double_range (star->coord_scale[1], 1.0f - star->coord_scale[1]);
-
-  star->start_time = g_timer_elapsed (data->timer, NULL);
-
-  tint_value = g_random_int_range (0, 7);
-
-  for (i = 0; i < 3; i++)
-    {
-      if ((tint_value & 1))
-        star->tint[i] = 1.0f;
-      else
-        star->tint[i] = 0.5f;
-
-      tint_value >>= 1;
-    }
-
-  /* Keep the stars ordered by size so that the bigger stars will be
-   * drawn on top */
-  for (l = data->stars; l; l = l->next)
-    {
-      Star *other_star = l->data;
-
-      if (other_star->draw_size > star->draw_size)
-        break;
-    }
-
-  data->stars = g_list_insert_before (data->stars, l, star);
-}
-
 static void
 paint (CoglFramebuffer *fb,
        const CoglGstRectangle *video_output,
        void *user_data)
 {
   Data *data = user_data;
-  float elapsed = g_timer_elapsed (data->timer, NULL);
+  double elapsed = g_timer_elapsed (data->timer, NULL);
   CoglPipeline *pipeline;
   int fb_width, fb_height;
-  GList *l, *next;
+  GList *l;
 
-  pipeline = cogl_pipeline_copy (data->pipeline);
-  cogl_gst_video_sink_attach_frame (data->sink, pipeline);
-  cogl_object_unref (data->pipeline);
-  data->pipeline = pipeline;
+  pipeline = data->pipeline;
+  texture_uploader_retarget_frame (data->sink, pipeline);
 
-  if (elapsed >= data->add_time)
-    {
-      add_star (data, video_output);
-      data->add_time =
-        elapsed + g_random_double_range (MIN_ADD_TIME, MAX_ADD_TIME);
-    }
+  stars_sim_update (data->sim,
+                    elapsed,
+                    video_output->width,
+                    video_output->height);
 
   cogl_framebuffer_clear4f (fb, COGL_BUFFER_BIT_COLOR, 0, 0, 0, 1);
 
@@ -206,39 +82,21 @@ paint (CoglFramebuffer *fb,
   cogl_framebuffer_translate (fb, (fb_width - fb_height) / 2.0f, 0.0f, 0.0f);
   cogl_framebuffer_scale (fb, fb_height, fb_height, 1.0f);
 
-  for (l = data->stars; l; l = next)
+  for (l = stars_sim_get_stars (data->sim); l; l = l->next)
     {
       Star *star = l->data;
-      float star_elapsed = elapsed - star->start_time;
       CoglPipeline *star_pipeline;
-      float x, y, angle;
-
-      next = l->next;
-
-      y = star->initial_y + star_elapsed * star->drop_speed;
-
-      /* If the star has fallen off the bottom of the screen then
-       * we'll just remove it so we don't paint it again */
-      if (y >= 1.0f + star->draw_size)
-        {
-          free_star (data, star);
-          continue;
-        }
-
-      x = star->initial_x + sinf (star_elapsed / 4.0f * G_PI) * star->wave_size;
 
       star_pipeline = cogl_pipeline_copy (pipeline);
 
       cogl_framebuffer_push_matrix (fb);
 
-      angle = star_elapsed * star->rotation_speed;
-
-      cogl_framebuffer_translate (fb, x, y, 0.0f);
+      cogl_framebuffer_translate (fb, star->x, star->y, 0.0f);
       cogl_framebuffer_scale (fb,
                               star->draw_size,
                               star->draw_size,
                               star->draw_size);
-      cogl_framebuffer_rotate (fb, angle, 0.0f, 0.0f, 1.0f);
+      cogl_framebuffer_rotate (fb, star->angle, 0.0f, 0.0f, 1.0f);
 
       cogl_pipeline_set_color4f (star_pipeline,
                                  star->tint[0],
@@ -376,6 +234,7 @@ init (CoglContext *context,
   create_pipeline (data);
   create_star_primitive (data);
 
+  data->sim = stars_sim_new (g_random_int ());
   data->timer = g_timer_new ();
 
   return data;
@@ -386,8 +245,7 @@ fini (void *user_data)
 {
   Data *data = user_data;
 
-  while (data->stars)
-    free_star (data, data->stars->data);
+  stars_sim_free (data->sim);
 
   cogl_object_unref (data->base_pipeline);
   if (data->pipeline)
@@ -403,4 +261,4 @@ fini (void *user_data)
   free (data);
 }
 
-EFFECT_DEFINE ("Stars", stars_effect)
+EFFECT_DEFINE ("Stars", stars_effect, EFFECT_FLAG_ANIMATED)
@@ -0,0 +1,295 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include "stars-sim.h"
+
+#define MIN_ADD_TIME 0.1f
+#define MAX_ADD_TIME 1.0f
+
+#define MIN_DRAW_SIZE 0.01f
+#define MAX_DRAW_SIZE 0.5f
+
+#define MIN_DROP_SPEED 0.1f
+#define MAX_DROP_SPEED 1.0f
+
+#define MIN_ROTATION_SPEED 0.0f
+#define MAX_ROTATION_SPEED 360.0f
+
+#define MIN_COORD_SCALE 0.01f
+#define MAX_COORD_SCALE 0.5f /* that is the whole video */
+
+#define MIN_WAVE_SIZE 0.0f
+#define MAX_WAVE_SIZE 0.5f
+
+struct _StarsSim
+{
+  GRand *rand;
+
+  GList *stars;
+
+  double add_time;
+};
+
+StarsSim *
+stars_sim_new (uint32_t seed)
+{
+  StarsSim *sim = g_slice_new (StarsSim);
+
+  sim->rand = g_rand_new_with_seed (seed);
+  sim->stars = NULL;
+  sim->add_time = 0.0;
+
+  return sim;
+}
+
+static void
+free_star (StarsSim *sim,
+           Star *star)
+{
+  sim->stars = g_list_remove (sim->stars, star);
+  g_slice_free (Star, star);
+}
+
+static Star *
+create_star (StarsSim *sim,
+             double elapsed,
+             float video_width,
+             float video_height)
+{
+  Star *star = g_slice_new (Star);
+  float coord_scale;
+  float size_speed;
+  int tint_value;
+  int i;
+
+  size_speed = g_rand_double (sim->rand);
+
+  star->draw_size =
+    (MAX_DRAW_SIZE - MIN_DRAW_SIZE) * size_speed + MIN_DRAW_SIZE;
+
+  star->wave_size =
+    (MAX_WAVE_SIZE - MIN_WAVE_SIZE) * (1.0f - size_speed) + MIN_WAVE_SIZE;
+  if (g_rand_boolean (sim->rand))
+    star->wave_size = -star->wave_size;
+
+  star->initial_x = g_rand_double (sim->rand);
+  star->initial_y = -star->draw_size;
+
+  star->drop_speed =
+    (MAX_DROP_SPEED - MIN_DROP_SPEED) * size_speed + MIN_DROP_SPEED;
+  star->rotation_speed =
+    g_rand_double_range (sim->rand, MIN_ROTATION_SPEED, MAX_ROTATION_SPEED);
+
+  coord_scale =
+    g_rand_double_range (sim->rand, MIN_COORD_SCALE, MAX_COORD_SCALE);
+
+  if (video_width < video_height)
+    {
+      star->coord_scale[0] = coord_scale;
+      star->coord_scale[1] = coord_scale * video_width / video_height;
+    }
+  else
+    {
+      star->coord_scale[1] = coord_scale;
+      star->coord_scale[0] = coord_scale * video_height / video_width;
+    }
+
+  star->coord_offset[0] =
+    g_rand_double_range (sim->rand,
+                         star->coord_scale[0],
+                         1.0f - star->coord_scale[0]);
+  star->coord_offset[1] =
+    g_rand_double_range (sim->rand,
+                         star->coord_scale[1],
+                         1.0f - star->coord_scale[1]);
+
+  star->start_time = elapsed;
+
+  tint_value = g_rand_int_range (sim->rand, 0, 7);
+
+  for (i = 0; i < 3; i++)
+    {
+      if ((tint_value & 1))
+        star->tint[i] = 1.0f;
+      else
+        star->tint[i] = 0.5f;
+
+      tint_value >>= 1;
+    }
+
+  star->x = star->initial_x;
+  star->y = star->initial_y;
+  star->angle = 0.0f;
+
+  return star;
+}
+
+void
+stars_sim_add_star (StarsSim *sim,
+                    double elapsed,
+                    float video_width,
+                    float video_height)
+{
+  Star *star = create_star (sim, elapsed, video_width, video_height);
+  GList *l;
+
+  /* Keep the stars ordered by size so that the bigger stars will be
+   * drawn on top */
+  for (l = sim->stars; l; l = l->next)
+    {
+      Star *other_star = l->data;
+
+      if (other_star->draw_size > star->draw_size)
+        break;
+    }
+
+  sim->stars = g_list_insert_before (sim->stars, l, star);
+}
+
+static int
+compare_star_size (const void *a,
+                   const void *b)
+{
+  const Star *star_a = a, *star_b = b;
+
+  if (star_a->draw_size < star_b->draw_size)
+    return -1;
+  else if (star_a->draw_size > star_b->draw_size)
+    return 1;
+  else
+    return 0;
+}
+
+void
+stars_sim_add_stars (StarsSim *sim,
+                     int n_stars,
+                     double elapsed,
+                     float video_width,
+                     float video_height)
+{
+  GList *new_stars = NULL, *head = NULL, *tail = NULL;
+  GList *a, *b;
+  int i;
+
+  for (i = 0; i < n_stars; i++)
+    new_stars = g_list_prepend (new_stars,
+                                create_star (sim,
+                                             elapsed,
+                                             video_width,
+                                             video_height));
+
+  new_stars = g_list_sort (new_stars, compare_star_size);
+
+  /* Merge the two sorted lists. The existing stars are kept first
+   * when the sizes are equal to match stars_sim_add_star() */
+  a = sim->stars;
+  b = new_stars;
+
+  while (a || b)
+    {
+      GList *next;
+
+      if (b == NULL ||
+          (a && compare_star_size (a->data, b->data) <= 0))
+        {
+          next = a;
+          a = a->next;
+        }
+      else
+        {
+          next = b;
+          b = b->next;
+        }
+
+      next->prev = tail;
+      if (tail)
+        tail->next = next;
+      else
+        head = next;
+      tail = next;
+    }
+
+  if (tail)
+    tail->next = NULL;
+
+  sim->stars = head;
+}
+
+void
+stars_sim_update (StarsSim *sim,
+                  double elapsed,
+                  float video_width,
+                  float video_height)
+{
+  GList *l, *next;
+
+  if (elapsed >= sim->add_time)
+    {
+      stars_sim_add_star (sim, elapsed, video_width, video_height);
+      sim->add_time =
+        elapsed + g_rand_double_range (sim->rand, MIN_ADD_TIME, MAX_ADD_TIME);
+    }
+
+  for (l = sim->stars; l; l = next)
+    {
+      Star *star = l->data;
+      float star_elapsed = elapsed - star->start_time;
+
+      next = l->next;
+
+      star->y = star->initial_y + star_elapsed * star->drop_speed;
+
+      /* If the star has fallen off the bottom of the screen then
+       * we'll just remove it so we don't paint it again */
+      if (star->y >= 1.0f + star->draw_size)
+        {
+          free_star (sim, star);
+          continue;
+        }
+
+      star->x = (star->initial_x +
+                 sinf (star_elapsed / 4.0f * G_PI) * star->wave_size);
+      star->angle = star_elapsed * star->rotation_speed;
+    }
+}
+
+GList *
+stars_sim_get_stars (StarsSim *sim)
+{
+  return sim->stars;
+}
+
+void
+stars_sim_free (StarsSim *sim)
+{
+  while (sim->stars)
+    free_star (sim, sim->stars->data);
+
+  g_rand_free (sim->rand);
+
+  g_slice_free (StarsSim, sim);
+}
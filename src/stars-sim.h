@@ -0,0 +1,94 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _STARS_SIM_H
+#define _STARS_SIM_H
+
+#include <stdint.h>
+#include <glib.h>
+
+/* The simulation for the stars effect. This doesn't depend on Cogl
+ * so that it can be driven from the micro-benchmark */
+
+typedef struct
+{
+  float initial_x, initial_y;
+  float drop_speed;
+  float rotation_speed;
+
+  float coord_scale[2];
+  float coord_offset[2];
+  float tint[3];
+
+  float draw_size;
+  float wave_size;
+
+  /* This is a double so that it keeps enough precision when the
+   * simulation has been running for a long time */
+  double start_time;
+
+  /* These are updated by stars_sim_update() */
+  float x, y;
+  float angle;
+} Star;
+
+typedef struct _StarsSim StarsSim;
+
+StarsSim *
+stars_sim_new (uint32_t seed);
+
+/* Adds a random star. The video size is used to pick the part of
+ * the video that the star shows. elapsed is the time in seconds
+ * since the simulation started */
+void
+stars_sim_add_star (StarsSim *sim,
+                    double elapsed,
+                    float video_width,
+                    float video_height);
+
+/* Adds n_stars random stars at once. This is quicker than adding
+ * them one at a time because they are merged into the list in a
+ * single pass */
+void
+stars_sim_add_stars (StarsSim *sim,
+                     int n_stars,
+                     double elapsed,
+                     float video_width,
+                     float video_height);
+
+/* Adds new stars when they are due, moves all of the stars and
+ * removes the ones that have fallen off the screen */
+void
+stars_sim_update (StarsSim *sim,
+                  double elapsed,
+                  float video_width,
+                  float video_height);
+
+/* Returns the list of Stars ordered by size */
+GList *
+stars_sim_get_stars (StarsSim *sim);
+
+void
+stars_sim_free (StarsSim *sim);
+
+#endif /* _STARS_SIM_H */
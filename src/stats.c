@@ -0,0 +1,249 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <glib.h>
+
+#include "stats.h"
+
+void
+stats_init (Stats *stats)
+{
+  memset (stats, 0, sizeof (Stats));
+
+  stats->paint_time = histogram_new ();
+  stats->queue_latency = histogram_new ();
+  stats->loop_gap = histogram_new ();
+  stats->command_latency = histogram_new ();
+  stats->glass_latency = histogram_new ();
+  stats->seek_latency = histogram_new ();
+  stats->effect_switch_latency = histogram_new ();
+
+  stats->init_time = g_get_monotonic_time ();
+  stats->rate_start_time = stats->init_time;
+}
+
+void
+stats_destroy (Stats *stats)
+{
+  histogram_free (stats->paint_time);
+  histogram_free (stats->queue_latency);
+  histogram_free (stats->loop_gap);
+  histogram_free (stats->command_latency);
+  histogram_free (stats->glass_latency);
+  histogram_free (stats->seek_latency);
+  histogram_free (stats->effect_switch_latency);
+}
+
+static void
+write_json_string (FILE *out,
+                   const char *str)
+{
+  fputc ('"', out);
+
+  for (; *str; str++)
+    {
+      if (*str == '"' || *str == '\\')
+        fprintf (out, "\\%c", *str);
+      else if ((unsigned char) *str < ' ')
+        fprintf (out, "\\u%04x", *str);
+      else
+        fputc (*str, out);
+    }
+
+  fputc ('"', out);
+}
+
+void
+stats_set_rate (Stats *stats,
+                int rate)
+{
+  StatsRate *current = stats->rates + stats->rate;
+  int64_t now = g_get_monotonic_time ();
+
+  current->frames_decoded += stats->frames_decoded - stats->rate_start_decoded;
+  current->frames_painted += stats->frames_painted - stats->rate_start_painted;
+  current->time += now - stats->rate_start_time;
+
+  stats->rate = rate;
+  stats->rate_start_time = now;
+  stats->rate_start_decoded = stats->frames_decoded;
+  stats->rate_start_painted = stats->frames_painted;
+}
+
+static void
+write_rates (const Stats *stats,
+             FILE *out)
+{
+  bool first = true;
+  int i;
+
+  fputs (", \"rates\": [", out);
+
+  for (i = 0; i < STATS_N_RATES; i++)
+    {
+      const StatsRate *rate = stats->rates + i;
+
+      if (rate->time <= 0)
+        continue;
+
+      fprintf (out,
+               "%s{\"rate\": %i"
+               ", \"decoded_fps\": %.3f"
+               ", \"painted_fps\": %.3f}",
+               first ? "" : ", ",
+               1 << i,
+               rate->frames_decoded * 1e6 / rate->time,
+               rate->frames_painted * 1e6 / rate->time);
+      first = false;
+    }
+
+  fputc (']', out);
+}
+
+static void
+write_effect_stats (const Stats *stats,
+                    FILE *out)
+{
+  bool first = true;
+  int i;
+
+  fputs (", \"frame_attaches\": {", out);
+
+  for (i = 0; i < N_EFFECTS; i++)
+    {
+      const StatsEffect *effect_stats = stats->effect_stats + i;
+
+      if (effect_stats->attach_hits == 0 &&
+          effect_stats->attach_retargets == 0)
+        continue;
+
+      if (!first)
+        fputs (", ", out);
+      write_json_string (out, effects[i]->name);
+      fprintf (out,
+               ": {\"hits\": %i, \"retargets\": %i}",
+               effect_stats->attach_hits,
+               effect_stats->attach_retargets);
+      first = false;
+    }
+
+  fputc ('}', out);
+}
+
+void
+stats_write_json (const Stats *stats,
+                  FILE *out,
+                  const char *effect,
+                  const char *input,
+                  const char *mode)
+{
+  double duration = (stats->end_time - stats->start_time) / 1e6;
+  int frames = stats->frames_painted;
+
+  /* In decode-only mode nothing is painted so the throughput is
+   * measured from the decoded frames instead */
+  if (frames == 0)
+    frames = stats->frames_decoded;
+
+  fputs ("{\"effect\": ", out);
+  write_json_string (out, effect);
+  fputs (", \"input\": ", out);
+  write_json_string (out, input);
+  fputs (", \"mode\": ", out);
+  write_json_string (out, mode);
+
+  fprintf (out,
+           ", \"frames\": %i"
+           ", \"duration_s\": %.6f"
+           ", \"fps\": %.3f",
+           frames,
+           duration,
+           duration > 0.0 ? frames / duration : 0.0);
+
+  /* This is mostly shader compilation and prerolling so it shows how
+   * much the shader cache helps */
+  if (stats->first_paint_time)
+    fprintf (out,
+             ", \"time_to_first_frame_ms\": %.3f",
+             (stats->first_paint_time - stats->init_time) / 1e3);
+
+  fprintf (out,
+           ", \"paint_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f}",
+           histogram_get_mean (stats->paint_time) / 1e6,
+           histogram_get_percentile (stats->paint_time, 50.0) / 1e6,
+           histogram_get_percentile (stats->paint_time, 99.0) / 1e6);
+
+  fprintf (out,
+           ", \"queue_latency_ms\": {\"p50\": %.4f, \"p99\": %.4f}",
+           histogram_get_percentile (stats->queue_latency, 50.0) / 1e6,
+           histogram_get_percentile (stats->queue_latency, 99.0) / 1e6);
+
+  fprintf (out,
+           ", \"glass_to_glass_ms\": {\"p50\": %.4f, \"p99\": %.4f, "
+           "\"max\": %.4f}",
+           histogram_get_percentile (stats->glass_latency, 50.0) / 1e6,
+           histogram_get_percentile (stats->glass_latency, 99.0) / 1e6,
+           histogram_get_max (stats->glass_latency) / 1e6);
+
+  fprintf (out,
+           ", \"seeks\": %" G_GUINT64_FORMAT
+           ", \"seek_latency_ms\": {\"p50\": %.4f, \"max\": %.4f}",
+           (guint64) histogram_get_count (stats->seek_latency),
+           histogram_get_percentile (stats->seek_latency, 50.0) / 1e6,
+           histogram_get_max (stats->seek_latency) / 1e6);
+
+  fprintf (out,
+           ", \"effect_switches\": %" G_GUINT64_FORMAT
+           ", \"effect_switch_ms\": {\"p50\": %.4f, \"max\": %.4f}",
+           (guint64) histogram_get_count (stats->effect_switch_latency),
+           histogram_get_percentile (stats->effect_switch_latency, 50.0) / 1e6,
+           histogram_get_max (stats->effect_switch_latency) / 1e6);
+
+  write_rates (stats, out);
+  write_effect_stats (stats, out);
+
+  fprintf (out,
+           ", \"loops\": %i"
+           ", \"loop_gap_ms\": {\"p50\": %.4f, \"max\": %.4f}",
+           stats->loops,
+           histogram_get_percentile (stats->loop_gap, 50.0) / 1e6,
+           histogram_get_max (stats->loop_gap) / 1e6);
+
+  fprintf (out,
+           ", \"decoded_frames\": %i"
+           ", \"dropped_frames\": %i"
+           ", \"late_frames\": %i"
+           ", \"painted_late_frames\": %i"
+           ", \"duplicate_frames\": %i"
+           ", \"skipped_repaints\": %i}\n",
+           stats->frames_decoded,
+           stats->frames_dropped,
+           stats->frames_late,
+           stats->frames_painted_late,
+           stats->frames_duplicate,
+           stats->repaints_skipped);
+}
@@ -0,0 +1,139 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "histogram.h"
+#include "effects.h"
+
+/* Number of playback rates that are counted separately. Rate n is
+ * 2^n times normal speed */
+#define STATS_N_RATES 6
+
+typedef struct
+{
+  int frames_decoded;
+  int frames_painted;
+  /* Time spent at this rate in microseconds */
+  int64_t time;
+} StatsRate;
+
+typedef struct
+{
+  /* Paints where the effect's pipeline already had the frame */
+  int attach_hits;
+  /* Paints where the pipeline's layers were changed to a new frame */
+  int attach_retargets;
+} StatsEffect;
+
+typedef struct
+{
+  /* Monotonic times in microseconds of the first and last frame */
+  int64_t start_time;
+  int64_t end_time;
+
+  /* Monotonic times in microseconds of when the stats were
+   * initialised at startup and of the first paint */
+  int64_t init_time;
+  int64_t first_paint_time;
+
+  int frames_decoded;
+  int frames_painted;
+  /* Frames that were decoded but never painted. This includes the
+   * frames that were replaced before we got a chance to paint them
+   * and the ones the sink threw away */
+  int frames_dropped;
+  /* Frames that the sink threw away because they were too late */
+  int frames_late;
+  /* Frames that were painted after the vblank they were meant for */
+  int frames_painted_late;
+  /* Frames that weren't uploaded because they were the same as the
+   * previous frame */
+  int frames_duplicate;
+  /* Duplicate frames that didn't need to be painted either */
+  int repaints_skipped;
+
+  /* Number of times the video has looped */
+  int loops;
+
+  /* Error messages posted on the pipeline's bus */
+  int bus_errors;
+
+  /* The frame counts and time for each playback rate. The current
+   * rate only includes the frames up to the last stats_set_rate() */
+  StatsRate rates[STATS_N_RATES];
+  int rate;
+  int64_t rate_start_time;
+  int rate_start_decoded;
+  int rate_start_painted;
+
+  /* Counts for each effect in the same order as effects[] */
+  StatsEffect effect_stats[N_EFFECTS];
+
+  /* Time spent in paint() in nanoseconds */
+  Histogram *paint_time;
+  /* Time from each frame reaching the sink to it being painted in
+   * nanoseconds */
+  Histogram *queue_latency;
+  /* Time between the last frame of a loop and the first frame of the
+   * next one reaching the sink in nanoseconds */
+  Histogram *loop_gap;
+  /* Time from a command on the control socket to the first frame
+   * painted with its effect in nanoseconds */
+  Histogram *command_latency;
+  /* Time from a live source capturing a frame to it being presented
+   * in nanoseconds */
+  Histogram *glass_latency;
+  /* Time from a seek to the first frame after it being painted in
+   * nanoseconds */
+  Histogram *seek_latency;
+  /* Time from an effect switch being requested to the first frame
+   * painted with the new effect in nanoseconds */
+  Histogram *effect_switch_latency;
+} Stats;
+
+void
+stats_init (Stats *stats);
+
+void
+stats_destroy (Stats *stats);
+
+/* Adds the frames since the last call to the current rate and then
+ * switches to the given rate. Calling it with the current rate just
+ * brings the counts up to date */
+void
+stats_set_rate (Stats *stats,
+                int rate);
+
+void
+stats_write_json (const Stats *stats,
+                  FILE *out,
+                  const char *effect,
+                  const char *input,
+                  const char *mode);
+
+#endif /* _STATS_H */
@@ -0,0 +1,811 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gst/video/video.h>
+
+#include "texture-uploader.h"
+#include "channel.h"
+#include "frame-history.h"
+#include "sink-clock.h"
+#include "trace.h"
+
+/* One pixel buffer being filled, one waiting to be painted and one
+ * being painted */
+#define N_SLOTS 3
+
+#define MAX_TEXTURES 3
+
+/* Buffers are taken this long before the sink would have rendered
+ * them to leave time for the copy and the upload */
+#define UPLOAD_LEAD_TIME (4 * GST_MSECOND)
+
+#define UPLOADER_KEY "sprite-player-texture-uploader"
+#define ATTACH_COUNTS_KEY "sprite-player-attach-counts"
+
+/* The video planes plus any layers of the effect's own */
+#define MAX_PIPELINE_LAYERS 8
+
+typedef enum
+{
+  /* The pixel buffer is mapped and can be given a new frame */
+  SLOT_FREE,
+  /* The upload thread is copying a frame into the pixel buffer */
+  SLOT_FILLING,
+  /* The pixel buffer is too small and is being reallocated by the
+   * render thread */
+  SLOT_RESIZING,
+  /* The frame has been copied and the render thread hasn't created
+   * the textures yet */
+  SLOT_READY,
+  /* The textures are the current frame or are waiting for the GPU to
+   * finish with them */
+  SLOT_IN_USE
+} SlotState;
+
+typedef struct
+{
+  int n_layers;
+  int layers[MAX_PIPELINE_LAYERS];
+  CoglTexture *textures[MAX_PIPELINE_LAYERS];
+} LayerTextures;
+
+typedef enum
+{
+  MESSAGE_RESIZE,
+  MESSAGE_READY
+} MessageType;
+
+typedef struct
+{
+  TextureUploader *uploader;
+
+  /* Protected by the mutex */
+  SlotState state;
+
+  /* Mapped memory of the pixel buffer. This is only changed by the
+   * render thread while the upload thread isn't using the slot */
+  uint8_t *data;
+  size_t size;
+
+  /* These are only used by the render thread */
+  CoglPixelBuffer *pixel_buffer;
+  CoglFenceClosure *fence;
+  int n_textures;
+  CoglTexture *textures[MAX_TEXTURES];
+  /* The format and size of the textures so that they can be reused
+   * for the next frame in the slot */
+  GstVideoFormat texture_format;
+  int texture_width;
+  int texture_height;
+
+  /* The frame in the slot */
+  GstBuffer *buffer;
+  GstVideoInfo info;
+  int64_t target_time;
+  int64_t arrival_time;
+} Slot;
+
+struct _TextureUploader
+{
+  CoglContext *context;
+  CoglGstVideoSink *sink;
+  CoglFramebuffer *fb;
+
+  TextureUploaderFrameFunc frame_func;
+  void *user_data;
+
+  GThread *thread;
+  GAsyncQueue *jobs;
+  Channel *to_render;
+
+  GMutex mutex;
+  GCond cond;
+  bool stopped;
+  Slot slots[N_SLOTS];
+
+  SinkClock *sink_clock;
+
+  /* Set if a pixel buffer can't be mapped */
+  int disabled;
+
+  /* These are only used by the streaming thread */
+  GstVideoInfo info;
+  bool have_info;
+
+  /* Set when the next buffer should go to the sink. This can be set
+   * from the thread that flushes the pipeline */
+  int pass_next;
+
+  /* These are only used by the render thread */
+  Slot *current;
+  bool use_own_frame;
+};
+
+typedef struct
+{
+  GstVideoFormat video_format;
+  int n_textures;
+  CoglPixelFormat formats[MAX_TEXTURES];
+} FormatInfo;
+
+/* These need to match the textures that CoglGstVideoSink creates so
+ * that its shaders can sample them. There is one texture for each
+ * component of the planar formats */
+static const FormatInfo
+format_infos[] =
+  {
+    { GST_VIDEO_FORMAT_RGB, 1, { COGL_PIXEL_FORMAT_RGB_888 } },
+    { GST_VIDEO_FORMAT_BGR, 1, { COGL_PIXEL_FORMAT_BGR_888 } },
+    { GST_VIDEO_FORMAT_RGBA, 1, { COGL_PIXEL_FORMAT_RGBA_8888 } },
+    { GST_VIDEO_FORMAT_BGRA, 1, { COGL_PIXEL_FORMAT_BGRA_8888 } },
+    { GST_VIDEO_FORMAT_I420, 3,
+      { COGL_PIXEL_FORMAT_I_8, COGL_PIXEL_FORMAT_I_8, COGL_PIXEL_FORMAT_I_8 } },
+    { GST_VIDEO_FORMAT_YV12, 3,
+      { COGL_PIXEL_FORMAT_I_8, COGL_PIXEL_FORMAT_I_8, COGL_PIXEL_FORMAT_I_8 } }
+  };
+
+static const FormatInfo *
+get_format_info (GstVideoFormat video_format)
+{
+  int i;
+
+  for (i = 0; i < G_N_ELEMENTS (format_infos); i++)
+    if (format_infos[i].video_format == video_format)
+      return format_infos + i;
+
+  return NULL;
+}
+
+static int
+get_slot_num (Slot *slot)
+{
+  return slot - slot->uploader->slots;
+}
+
+static void
+set_slot_state (Slot *slot,
+                SlotState state)
+{
+  TextureUploader *uploader = slot->uploader;
+
+  g_mutex_lock (&uploader->mutex);
+  slot->state = state;
+  g_cond_broadcast (&uploader->cond);
+  g_mutex_unlock (&uploader->mutex);
+}
+
+static bool
+copy_frame (Slot *slot)
+{
+  GstVideoFrame src, dst;
+  GstBuffer *wrapper;
+  bool ret = false;
+
+  /* The source frame is mapped using its video meta so any padding
+   * in the decoder's buffers is removed by the copy */
+  if (!gst_video_frame_map (&src, &slot->info, slot->buffer, GST_MAP_READ))
+    return false;
+
+  wrapper = gst_buffer_new_wrapped_full (0, /* flags */
+                                         slot->data,
+                                         slot->size,
+                                         0, /* offset */
+                                         GST_VIDEO_INFO_SIZE (&slot->info),
+                                         NULL, /* user_data */
+                                         NULL /* notify */);
+
+  if (gst_video_frame_map (&dst, &slot->info, wrapper, GST_MAP_WRITE))
+    {
+      ret = gst_video_frame_copy (&dst, &src);
+      gst_video_frame_unmap (&dst);
+    }
+
+  gst_buffer_unref (wrapper);
+  gst_video_frame_unmap (&src);
+
+  return ret;
+}
+
+static void
+upload_slot (TextureUploader *uploader,
+             Slot *slot)
+{
+  size_t size = GST_VIDEO_INFO_SIZE (&slot->info);
+  int64_t trace_start;
+  bool ok;
+
+  g_mutex_lock (&uploader->mutex);
+
+  if (slot->size < size)
+    {
+      /* Only the render thread can reallocate the pixel buffer */
+      slot->state = SLOT_RESIZING;
+      slot->size = size;
+      channel_send (uploader->to_render,
+                    MESSAGE_RESIZE,
+                    get_slot_num (slot));
+
+      while (slot->state == SLOT_RESIZING && !uploader->stopped)
+        g_cond_wait (&uploader->cond, &uploader->mutex);
+    }
+
+  ok = slot->state == SLOT_FILLING && slot->data != NULL;
+
+  g_mutex_unlock (&uploader->mutex);
+
+  trace_start = trace_begin ();
+
+  if (ok && copy_frame (slot))
+    {
+      trace_end ("upload-copy", trace_start);
+      set_slot_state (slot, SLOT_READY);
+      channel_send (uploader->to_render, MESSAGE_READY, get_slot_num (slot));
+    }
+  else
+    {
+      gst_buffer_unref (slot->buffer);
+      slot->buffer = NULL;
+      set_slot_state (slot, SLOT_FREE);
+    }
+}
+
+static void *
+upload_thread_func (void *user_data)
+{
+  TextureUploader *uploader = user_data;
+  void *job;
+
+  trace_set_thread_name ("upload");
+
+  /* The uploader itself is pushed to tell the thread to quit */
+  while ((job = g_async_queue_pop (uploader->jobs)) != uploader)
+    upload_slot (uploader, job);
+
+  return NULL;
+}
+
+static void
+map_slot (Slot *slot)
+{
+  TextureUploader *uploader = slot->uploader;
+
+  /* The discard hint lets the driver give us fresh memory instead of
+   * waiting for any pending copies from the old contents */
+  slot->data = cogl_buffer_map (COGL_BUFFER (slot->pixel_buffer),
+                                COGL_BUFFER_ACCESS_WRITE,
+                                COGL_BUFFER_MAP_HINT_DISCARD);
+
+  if (slot->data == NULL && !g_atomic_int_get (&uploader->disabled))
+    {
+      g_warning ("Failed to map a pixel buffer so the video will be "
+                 "uploaded by the sink");
+      g_atomic_int_set (&uploader->disabled, TRUE);
+    }
+}
+
+static void
+free_slot (Slot *slot)
+{
+  map_slot (slot);
+  set_slot_state (slot, SLOT_FREE);
+}
+
+static void
+resize_slot (TextureUploader *uploader,
+             Slot *slot)
+{
+  if (slot->pixel_buffer)
+    {
+      if (slot->data)
+        cogl_buffer_unmap (COGL_BUFFER (slot->pixel_buffer));
+      cogl_object_unref (slot->pixel_buffer);
+    }
+
+  slot->pixel_buffer = cogl_pixel_buffer_new (uploader->context,
+                                              slot->size,
+                                              NULL /* data */);
+  map_slot (slot);
+
+  g_mutex_lock (&uploader->mutex);
+  if (slot->state == SLOT_RESIZING)
+    slot->state = SLOT_FILLING;
+  g_cond_broadcast (&uploader->cond);
+  g_mutex_unlock (&uploader->mutex);
+}
+
+static void
+free_textures (Slot *slot)
+{
+  int i;
+
+  for (i = 0; i < slot->n_textures; i++)
+    cogl_object_unref (slot->textures[i]);
+
+  slot->n_textures = 0;
+}
+
+static bool
+can_reuse_textures (Slot *slot)
+{
+  /* The frame history keeps references on the textures of old frames
+   * so they mustn't be overwritten */
+  return (slot->n_textures > 0 &&
+          slot->texture_format == GST_VIDEO_INFO_FORMAT (&slot->info) &&
+          slot->texture_width == GST_VIDEO_INFO_WIDTH (&slot->info) &&
+          slot->texture_height == GST_VIDEO_INFO_HEIGHT (&slot->info) &&
+          !frame_history_is_recording (slot->uploader->sink));
+}
+
+static bool
+create_textures (Slot *slot)
+{
+  const FormatInfo *format_info =
+    get_format_info (GST_VIDEO_INFO_FORMAT (&slot->info));
+  bool reuse = can_reuse_textures (slot);
+  CoglTexture2D *texture;
+  CoglBitmap *bitmap;
+  bool ok;
+  int i, plane, width, height;
+
+  cogl_buffer_unmap (COGL_BUFFER (slot->pixel_buffer));
+  slot->data = NULL;
+
+  if (!reuse)
+    {
+      free_textures (slot);
+      slot->texture_format = GST_VIDEO_INFO_FORMAT (&slot->info);
+      slot->texture_width = GST_VIDEO_INFO_WIDTH (&slot->info);
+      slot->texture_height = GST_VIDEO_INFO_HEIGHT (&slot->info);
+    }
+
+  for (i = 0; i < format_info->n_textures; i++)
+    {
+      plane = GST_VIDEO_INFO_COMP_PLANE (&slot->info, i);
+      width = GST_VIDEO_INFO_COMP_WIDTH (&slot->info, i);
+      height = GST_VIDEO_INFO_COMP_HEIGHT (&slot->info, i);
+
+      bitmap =
+        cogl_bitmap_new_from_buffer (COGL_BUFFER (slot->pixel_buffer),
+                                     format_info->formats[i],
+                                     width,
+                                     height,
+                                     GST_VIDEO_INFO_PLANE_STRIDE (&slot->info,
+                                                                  plane),
+                                     GST_VIDEO_INFO_PLANE_OFFSET (&slot->info,
+                                                                  plane));
+      /* The data is copied from the bound pixel buffer so the GL
+       * driver can do it without stalling */
+      if (reuse)
+        {
+          ok = cogl_texture_set_region_from_bitmap (slot->textures[i],
+                                                    0, 0, /* src_x/y */
+                                                    0, 0, /* dst_x/y */
+                                                    width, height,
+                                                    bitmap);
+        }
+      else
+        {
+          texture = cogl_texture_2d_new_from_bitmap (bitmap,
+                                                     format_info->formats[i],
+                                                     NULL /* error */);
+          ok = texture != NULL;
+
+          if (ok)
+            slot->textures[slot->n_textures++] = COGL_TEXTURE (texture);
+        }
+
+      cogl_object_unref (bitmap);
+
+      if (!ok)
+        {
+          free_textures (slot);
+          return false;
+        }
+    }
+
+  return true;
+}
+
+static void
+fence_cb (CoglFence *fence,
+          void *user_data)
+{
+  Slot *slot = user_data;
+
+  slot->fence = NULL;
+  free_slot (slot);
+}
+
+static void
+retire_slot (TextureUploader *uploader,
+             Slot *slot)
+{
+  /* The textures are kept for the next frame in the slot. The pixel
+   * buffer can't be reused until the GPU has finished copying from
+   * it. The rendering that used it was added to the journal before
+   * this fence */
+  if (cogl_has_feature (uploader->context, COGL_FEATURE_ID_FENCE))
+    slot->fence = cogl_framebuffer_add_fence_callback (uploader->fb,
+                                                      fence_cb,
+                                                      slot);
+
+  if (slot->fence == NULL)
+    free_slot (slot);
+}
+
+static void
+show_slot (TextureUploader *uploader,
+           Slot *slot)
+{
+  int64_t trace_start = trace_begin ();
+  GstBuffer *buffer;
+
+  if (!create_textures (slot))
+    {
+      gst_buffer_unref (slot->buffer);
+      slot->buffer = NULL;
+      free_slot (slot);
+      return;
+    }
+
+  trace_end ("upload-textures", trace_start);
+
+  if (uploader->current)
+    retire_slot (uploader, uploader->current);
+
+  set_slot_state (slot, SLOT_IN_USE);
+  uploader->current = slot;
+  uploader->use_own_frame = true;
+
+  buffer = slot->buffer;
+  slot->buffer = NULL;
+
+  uploader->frame_func (buffer,
+                        slot->target_time,
+                        slot->arrival_time,
+                        uploader->user_data);
+}
+
+static void
+message_cb (const ChannelMessage *message,
+            void *user_data)
+{
+  TextureUploader *uploader = user_data;
+  Slot *slot = uploader->slots + message->value;
+
+  switch ((MessageType) message->type)
+    {
+    case MESSAGE_RESIZE:
+      resize_slot (uploader, slot);
+      break;
+
+    case MESSAGE_READY:
+      show_slot (uploader, slot);
+      break;
+    }
+}
+
+TextureUploader *
+texture_uploader_new (CoglGstVideoSink *sink,
+                      CoglFramebuffer *fb,
+                      TextureUploaderFrameFunc frame_func,
+                      void *user_data)
+{
+  TextureUploader *uploader = g_slice_new0 (TextureUploader);
+  int i;
+
+  uploader->sink = g_object_ref (sink);
+  uploader->fb = cogl_object_ref (fb);
+  uploader->context = cogl_framebuffer_get_context (fb);
+  uploader->frame_func = frame_func;
+  uploader->user_data = user_data;
+
+  g_mutex_init (&uploader->mutex);
+  g_cond_init (&uploader->cond);
+
+  uploader->sink_clock = sink_clock_new (GST_ELEMENT (sink),
+                                         UPLOAD_LEAD_TIME);
+
+  for (i = 0; i < N_SLOTS; i++)
+    uploader->slots[i].uploader = uploader;
+
+  uploader->to_render = channel_new (NULL, message_cb, uploader);
+  uploader->jobs = g_async_queue_new ();
+  uploader->thread = g_thread_new ("upload", upload_thread_func, uploader);
+
+  g_object_set_data (G_OBJECT (sink), UPLOADER_KEY, uploader);
+
+  return uploader;
+}
+
+void
+texture_uploader_handle_event (TextureUploader *uploader,
+                               GstEvent *event)
+{
+  sink_clock_handle_event (uploader->sink_clock, event);
+
+  switch (GST_EVENT_TYPE (event))
+    {
+    case GST_EVENT_CAPS:
+      {
+        GstCaps *caps;
+
+        gst_event_parse_caps (event, &caps);
+
+        uploader->have_info =
+          (gst_video_info_from_caps (&uploader->info, caps) &&
+           get_format_info (GST_VIDEO_INFO_FORMAT (&uploader->info)));
+
+        /* The sink needs a frame to set up its pipeline for the new
+         * format */
+        g_atomic_int_set (&uploader->pass_next, TRUE);
+        break;
+      }
+
+    case GST_EVENT_FLUSH_STOP:
+      /* The sink needs a frame to preroll again */
+      g_atomic_int_set (&uploader->pass_next, TRUE);
+      break;
+
+    default:
+      break;
+    }
+}
+
+bool
+texture_uploader_push (TextureUploader *uploader,
+                       GstBuffer *buffer,
+                       int64_t target_time,
+                       int64_t arrival_time)
+{
+  Slot *slot = NULL;
+  int i;
+
+  if (!uploader->have_info ||
+      g_atomic_int_get (&uploader->disabled) ||
+      g_atomic_int_compare_and_exchange (&uploader->pass_next, TRUE, FALSE))
+    return false;
+
+  /* A buffer that was interrupted by a flush is given to the sink
+   * which will throw it away */
+  if (!sink_clock_wait (uploader->sink_clock, buffer))
+    return false;
+
+  g_mutex_lock (&uploader->mutex);
+
+  while (!uploader->stopped)
+    {
+      for (i = 0; i < N_SLOTS; i++)
+        if (uploader->slots[i].state == SLOT_FREE)
+          {
+            slot = uploader->slots + i;
+            break;
+          }
+
+      if (slot)
+        break;
+
+      g_cond_wait (&uploader->cond, &uploader->mutex);
+    }
+
+  if (slot)
+    {
+      slot->state = SLOT_FILLING;
+      slot->buffer = gst_buffer_ref (buffer);
+      slot->info = uploader->info;
+      slot->target_time = target_time;
+      slot->arrival_time = arrival_time;
+    }
+
+  g_mutex_unlock (&uploader->mutex);
+
+  if (slot == NULL)
+    return false;
+
+  g_async_queue_push (uploader->jobs, slot);
+
+  return true;
+}
+
+void
+texture_uploader_use_sink_frame (TextureUploader *uploader)
+{
+  uploader->use_own_frame = false;
+}
+
+void
+texture_uploader_stop (TextureUploader *uploader)
+{
+  g_mutex_lock (&uploader->mutex);
+  uploader->stopped = true;
+  g_cond_broadcast (&uploader->cond);
+  g_mutex_unlock (&uploader->mutex);
+
+  sink_clock_stop (uploader->sink_clock);
+}
+
+void
+texture_uploader_free (TextureUploader *uploader)
+{
+  Slot *slot;
+  int i;
+
+  texture_uploader_stop (uploader);
+
+  g_async_queue_push (uploader->jobs, uploader);
+  g_thread_join (uploader->thread);
+  g_async_queue_unref (uploader->jobs);
+
+  channel_free (uploader->to_render);
+
+  for (i = 0; i < N_SLOTS; i++)
+    {
+      slot = uploader->slots + i;
+
+      if (slot->fence)
+        cogl_framebuffer_cancel_fence_callback (uploader->fb, slot->fence);
+
+      free_textures (slot);
+
+      if (slot->buffer)
+        gst_buffer_unref (slot->buffer);
+
+      if (slot->pixel_buffer)
+        {
+          if (slot->data)
+            cogl_buffer_unmap (COGL_BUFFER (slot->pixel_buffer));
+          cogl_object_unref (slot->pixel_buffer);
+        }
+    }
+
+  g_object_set_data (G_OBJECT (uploader->sink), UPLOADER_KEY, NULL);
+  g_object_unref (uploader->sink);
+  cogl_object_unref (uploader->fb);
+
+  sink_clock_free (uploader->sink_clock);
+
+  g_cond_clear (&uploader->cond);
+  g_mutex_clear (&uploader->mutex);
+
+  g_slice_free (TextureUploader, uploader);
+}
+
+void
+texture_uploader_attach_frame (CoglGstVideoSink *sink,
+                               CoglPipeline *pipeline)
+{
+  TextureUploader *uploader = g_object_get_data (G_OBJECT (sink),
+                                                 UPLOADER_KEY);
+  Slot *slot;
+  int first_layer, i;
+
+  /* An older frame is shown while stepping backwards */
+  if (frame_history_attach_frame (sink, pipeline))
+    return;
+
+  if (uploader == NULL ||
+      !uploader->use_own_frame ||
+      uploader->current == NULL)
+    {
+      cogl_gst_video_sink_attach_frame (sink, pipeline);
+      return;
+    }
+
+  slot = uploader->current;
+
+  /* The sink's shader samples the layers just before its free
+   * layer */
+  first_layer = cogl_gst_video_sink_get_free_layer (sink) - slot->n_textures;
+
+  for (i = 0; i < slot->n_textures; i++)
+    cogl_pipeline_set_layer_texture (pipeline,
+                                     first_layer + i,
+                                     slot->textures[i]);
+}
+
+static CoglBool
+get_layer_texture_cb (CoglPipeline *pipeline,
+                      int layer_index,
+                      void *user_data)
+{
+  LayerTextures *textures = user_data;
+
+  if (textures->n_layers >= MAX_PIPELINE_LAYERS)
+    return FALSE;
+
+  textures->layers[textures->n_layers] = layer_index;
+  textures->textures[textures->n_layers] =
+    cogl_pipeline_get_layer_texture (pipeline, layer_index);
+  textures->n_layers++;
+
+  return TRUE;
+}
+
+static void
+get_layer_textures (CoglPipeline *pipeline,
+                    LayerTextures *textures)
+{
+  textures->n_layers = 0;
+  cogl_pipeline_foreach_layer (pipeline, get_layer_texture_cb, textures);
+}
+
+static TextureAttachCounts *
+get_attach_counts (CoglGstVideoSink *sink)
+{
+  TextureAttachCounts *counts =
+    g_object_get_data (G_OBJECT (sink), ATTACH_COUNTS_KEY);
+
+  if (counts == NULL)
+    {
+      counts = g_new0 (TextureAttachCounts, 1);
+      g_object_set_data_full (G_OBJECT (sink),
+                              ATTACH_COUNTS_KEY,
+                              counts,
+                              g_free);
+    }
+
+  return counts;
+}
+
+bool
+texture_uploader_retarget_frame (CoglGstVideoSink *sink,
+                                 CoglPipeline *pipeline)
+{
+  TextureAttachCounts *counts = get_attach_counts (sink);
+  LayerTextures before, after;
+  bool changed;
+
+  get_layer_textures (pipeline, &before);
+  texture_uploader_attach_frame (sink, pipeline);
+  get_layer_textures (pipeline, &after);
+
+  frame_history_record (sink, pipeline);
+
+  changed = (before.n_layers != after.n_layers ||
+             memcmp (before.layers,
+                     after.layers,
+                     before.n_layers * sizeof (int)) ||
+             memcmp (before.textures,
+                     after.textures,
+                     before.n_layers * sizeof (CoglTexture *)));
+
+  if (changed)
+    counts->retargets++;
+  else
+    counts->hits++;
+
+  return changed;
+}
+
+void
+texture_uploader_take_attach_counts (CoglGstVideoSink *sink,
+                                     TextureAttachCounts *counts_out)
+{
+  TextureAttachCounts *counts = get_attach_counts (sink);
+
+  *counts_out = *counts;
+  memset (counts, 0, sizeof (*counts));
+}
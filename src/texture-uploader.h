@@ -0,0 +1,119 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _TEXTURE_UPLOADER_H
+#define _TEXTURE_UPLOADER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <cogl/cogl.h>
+#include <cogl-gst/cogl-gst.h>
+#include <gst/gst.h>
+
+/* Uploads the video frames off the render thread. Buffers are taken
+ * from the sink pad before they reach the sink and an upload thread
+ * copies them into pixel buffers that the render thread has mapped.
+ * The render thread then only has to create textures from the pixel
+ * buffers, which lets the GL driver copy the data asynchronously.
+ * Fences are used to know when a pixel buffer can be reused.
+ *
+ * The first buffer after each caps change or flush is still given to
+ * the sink so that it can set up its pipeline and preroll. Formats
+ * that the uploader doesn't know how to lay out are always left to
+ * the sink */
+
+typedef struct _TextureUploader TextureUploader;
+
+/* Called on the render thread when a frame has been uploaded. The
+ * reference on buffer is transferred to the function */
+typedef void
+(* TextureUploaderFrameFunc) (GstBuffer *buffer,
+                              int64_t target_time,
+                              int64_t arrival_time,
+                              void *user_data);
+
+TextureUploader *
+texture_uploader_new (CoglGstVideoSink *sink,
+                      CoglFramebuffer *fb,
+                      TextureUploaderFrameFunc frame_func,
+                      void *user_data);
+
+/* Called from the streaming thread for each event on the sink pad */
+void
+texture_uploader_handle_event (TextureUploader *uploader,
+                               GstEvent *event);
+
+/* Called from the streaming thread for each buffer. This can block
+ * until there is a free pixel buffer. Returns false if the buffer
+ * should be given to the sink instead */
+bool
+texture_uploader_push (TextureUploader *uploader,
+                       GstBuffer *buffer,
+                       int64_t target_time,
+                       int64_t arrival_time);
+
+/* Called on the render thread when the sink has a new frame of its
+ * own so that it is shown instead of the last uploaded one */
+void
+texture_uploader_use_sink_frame (TextureUploader *uploader);
+
+/* Unblocks the streaming thread. This must be called before shutting
+ * down the pipeline */
+void
+texture_uploader_stop (TextureUploader *uploader);
+
+void
+texture_uploader_free (TextureUploader *uploader);
+
+/* Attaches the current frame to the pipeline. This is a replacement
+ * for cogl_gst_video_sink_attach_frame() that uses the frame from the
+ * uploader when there is one for the sink, or the frame from the
+ * FrameHistory when stepping backwards */
+void
+texture_uploader_attach_frame (CoglGstVideoSink *sink,
+                               CoglPipeline *pipeline);
+
+/* Counts of the calls to texture_uploader_retarget_frame() for a
+ * sink */
+typedef struct
+{
+  /* The pipeline already had the frame's textures */
+  int hits;
+  /* Some of the layers were changed to the frame's textures */
+  int retargets;
+} TextureAttachCounts;
+
+/* Attaches the current frame to a pipeline that is kept between
+ * paints instead of to a new copy. Cogl ignores setting a layer to
+ * the texture that it already has so the pipeline only changes when
+ * there is a new frame. Returns true if any of the layers changed */
+bool
+texture_uploader_retarget_frame (CoglGstVideoSink *sink,
+                                 CoglPipeline *pipeline);
+
+/* Gets the counts for the sink since the last call and resets them */
+void
+texture_uploader_take_attach_counts (CoglGstVideoSink *sink,
+                                     TextureAttachCounts *counts);
+
+#endif /* _TEXTURE_UPLOADER_H */
@@ -0,0 +1,266 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <glib/gstdio.h>
+
+#include "trace.h"
+
+/* Each thread keeps a ring of this many events so that recording
+ * never has to allocate. Once it is full the oldest events are
+ * overwritten so the trace always has the end of the session. This
+ * must be a power of two */
+#define EVENTS_PER_THREAD (64 * 1024)
+
+typedef struct
+{
+  const char *name;
+  int64_t start;
+  int64_t duration;
+} TraceEvent;
+
+typedef struct _TraceBuffer TraceBuffer;
+
+struct _TraceBuffer
+{
+  TraceBuffer *next;
+
+  int thread_id;
+  const char *thread_name;
+
+  /* Total number of events recorded. Only written by the owning
+   * thread. It is updated after the event is filled in so the writer
+   * never sees a partial event. Event n is stored at
+   * n % EVENTS_PER_THREAD */
+  unsigned int n_events;
+
+  TraceEvent events[EVENTS_PER_THREAD];
+};
+
+static bool trace_enabled = false;
+static TraceBuffer *trace_buffers = NULL;
+static int next_thread_id = 1;
+
+static GPrivate thread_buffer_key;
+
+static int64_t
+get_time (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+void
+trace_enable (void)
+{
+  trace_enabled = true;
+}
+
+static TraceBuffer *
+get_thread_buffer (void)
+{
+  TraceBuffer *buffer = g_private_get (&thread_buffer_key);
+
+  if (G_UNLIKELY (buffer == NULL))
+    {
+      buffer = g_new (TraceBuffer, 1);
+      buffer->thread_id = g_atomic_int_add (&next_thread_id, 1);
+      buffer->thread_name = NULL;
+      buffer->n_events = 0;
+
+      g_private_set (&thread_buffer_key, buffer);
+
+      /* The buffers are only freed by trace_free() once nothing is
+       * recording so they can be pushed onto the list without a
+       * lock */
+      do
+        buffer->next = g_atomic_pointer_get (&trace_buffers);
+      while (!g_atomic_pointer_compare_and_exchange (&trace_buffers,
+                                                     buffer->next,
+                                                     buffer));
+    }
+
+  return buffer;
+}
+
+void
+trace_set_thread_name (const char *name)
+{
+  if (trace_enabled)
+    get_thread_buffer ()->thread_name = name;
+}
+
+int64_t
+trace_begin (void)
+{
+  if (!trace_enabled)
+    return 0;
+
+  return get_time ();
+}
+
+void
+trace_end (const char *name,
+           int64_t start)
+{
+  TraceBuffer *buffer;
+  TraceEvent *event;
+
+  if (start == 0)
+    return;
+
+  buffer = get_thread_buffer ();
+
+  event = buffer->events + buffer->n_events % EVENTS_PER_THREAD;
+  event->name = name;
+  event->start = start;
+  event->duration = get_time () - start;
+
+  g_atomic_int_set ((int *) &buffer->n_events, buffer->n_events + 1);
+}
+
+static void
+write_events (FILE *out,
+              TraceBuffer *buffer)
+{
+  unsigned int n_events = g_atomic_int_get ((int *) &buffer->n_events);
+  unsigned int first_event = 0, n_skipped = 0, i;
+
+  if (n_events > EVENTS_PER_THREAD)
+    first_event = n_events - EVENTS_PER_THREAD;
+
+  for (i = first_event; i != n_events; i++)
+    {
+      TraceEvent event = buffer->events[i % EVENTS_PER_THREAD];
+
+      /* The thread may still be recording. If it has wrapped around
+       * to this event while it was being copied then it might be
+       * torn */
+      if (g_atomic_int_get ((int *) &buffer->n_events) - i >
+          EVENTS_PER_THREAD)
+        {
+          n_skipped++;
+          continue;
+        }
+
+      fprintf (out,
+               ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+               "\"tid\": %i, \"ts\": %.3f, \"dur\": %.3f}",
+               event.name,
+               buffer->thread_id,
+               event.start / 1000.0,
+               event.duration / 1000.0);
+    }
+
+  if (first_event + n_skipped > 0)
+    g_message ("The oldest %u trace events from thread %i were "
+               "overwritten",
+               first_event + n_skipped,
+               buffer->thread_id);
+}
+
+gboolean
+trace_write (const char *filename,
+             GError **error)
+{
+  TraceBuffer *buffer;
+  bool first = true;
+  FILE *out;
+
+  out = g_fopen (filename, "w");
+
+  if (out == NULL)
+    {
+      int errnum = errno;
+
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   g_file_error_from_errno (errnum),
+                   "%s: %s",
+                   filename,
+                   strerror (errnum));
+      return FALSE;
+    }
+
+  fputs ("{\"traceEvents\": [\n", out);
+
+  for (buffer = g_atomic_pointer_get (&trace_buffers);
+       buffer;
+       buffer = buffer->next)
+    {
+      if (!first)
+        fputs (",\n", out);
+      first = false;
+
+      fprintf (out,
+               "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+               "\"tid\": %i, \"args\": {\"name\": \"%s\"}}",
+               buffer->thread_id,
+               buffer->thread_name ? buffer->thread_name : "other");
+
+      write_events (out, buffer);
+    }
+
+  fputs ("\n]}\n", out);
+
+  if (fclose (out) == EOF)
+    {
+      int errnum = errno;
+
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   g_file_error_from_errno (errnum),
+                   "%s: %s",
+                   filename,
+                   strerror (errnum));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+void
+trace_free (void)
+{
+  TraceBuffer *buffer, *next;
+
+  trace_enabled = false;
+
+  for (buffer = trace_buffers; buffer; buffer = next)
+    {
+      next = buffer->next;
+      g_free (buffer);
+    }
+
+  trace_buffers = NULL;
+  g_private_set (&thread_buffer_key, NULL);
+}
@@ -0,0 +1,61 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+#include <glib.h>
+
+/* Records timed spans which can be written out in the Chrome
+ * trace-event format to be loaded into Perfetto or chrome://tracing.
+ * Each thread records into its own buffer without taking any locks.
+ * Nothing is recorded until trace_enable() is called */
+
+void
+trace_enable (void);
+
+/* Names the calling thread in the trace. name must be a static
+ * string */
+void
+trace_set_thread_name (const char *name);
+
+/* Returns the start time for a span or 0 if tracing is disabled */
+int64_t
+trace_begin (void);
+
+/* Records a span from start to now. name must be a static string */
+void
+trace_end (const char *name,
+           int64_t start);
+
+gboolean
+trace_write (const char *filename,
+             GError **error);
+
+/* Frees the recorded events. This must only be called once no other
+ * threads can be recording. Nothing is recorded afterwards */
+void
+trace_free (void);
+
+#endif /* _TRACE_H */
@@ -0,0 +1,172 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "config.h"
+
+#include <sys/stat.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+
+#include "unix-service.h"
+
+struct _UnixService
+{
+  GSocketService *service;
+  char *path;
+};
+
+/* Returns TRUE if nothing is listening on the socket at path */
+static gboolean
+is_stale_socket (const char *path)
+{
+  GSocketAddress *address;
+  GSocket *sock;
+  GError *error = NULL;
+  gboolean stale;
+
+  sock = g_socket_new (G_SOCKET_FAMILY_UNIX,
+                         G_SOCKET_TYPE_STREAM,
+                         G_SOCKET_PROTOCOL_DEFAULT,
+                         NULL /* error */);
+
+  if (sock == NULL)
+    return FALSE;
+
+  address = g_unix_socket_address_new (path);
+
+  if (g_socket_connect (sock, address, NULL /* cancellable */, &error))
+    {
+      stale = FALSE;
+    }
+  else
+    {
+      stale = g_error_matches (error,
+                               G_IO_ERROR,
+                               G_IO_ERROR_CONNECTION_REFUSED);
+      g_error_free (error);
+    }
+
+  g_object_unref (address);
+  g_socket_close (sock, NULL /* error */);
+  g_object_unref (sock);
+
+  return stale;
+}
+
+/* Removes a socket left behind by a previous instance. Anything
+ * other than a socket is left alone so that a mistyped path can't
+ * delete a file, and so is a socket that another instance is still
+ * listening on */
+static gboolean
+remove_stale_socket (const char *path,
+                     GError **error)
+{
+  GStatBuf buf;
+
+  if (g_lstat (path, &buf) == -1)
+    return TRUE;
+
+  if (!S_ISSOCK (buf.st_mode))
+    {
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   G_FILE_ERROR_EXIST,
+                   "%s: File exists and is not a socket",
+                   path);
+      return FALSE;
+    }
+
+  if (!is_stale_socket (path))
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_ADDRESS_IN_USE,
+                   "%s: Address already in use",
+                   path);
+      return FALSE;
+    }
+
+  g_unlink (path);
+
+  return TRUE;
+}
+
+UnixService *
+unix_service_new (const char *path,
+                  UnixServiceIncomingFunc incoming_func,
+                  void *user_data,
+                  GError **error)
+{
+  UnixService *service;
+  GSocketAddress *address;
+  gboolean ret;
+
+  if (!remove_stale_socket (path, error))
+    return NULL;
+
+  address = g_unix_socket_address_new (path);
+
+  service = g_slice_new (UnixService);
+  service->service = g_socket_service_new ();
+  service->path = g_strdup (path);
+
+  ret = g_socket_listener_add_address (G_SOCKET_LISTENER (service->service),
+                                       address,
+                                       G_SOCKET_TYPE_STREAM,
+                                       G_SOCKET_PROTOCOL_DEFAULT,
+                                       NULL, /* source_object */
+                                       NULL, /* effective_address */
+                                       error);
+
+  g_object_unref (address);
+
+  if (!ret)
+    {
+      g_object_unref (service->service);
+      g_free (service->path);
+      g_slice_free (UnixService, service);
+      return NULL;
+    }
+
+  g_signal_connect (service->service,
+                    "incoming",
+                    G_CALLBACK (incoming_func),
+                    user_data);
+
+  g_socket_service_start (service->service);
+
+  return service;
+}
+
+void
+unix_service_free (UnixService *service)
+{
+  g_socket_service_stop (service->service);
+  g_socket_listener_close (G_SOCKET_LISTENER (service->service));
+  g_object_unref (service->service);
+
+  remove_stale_socket (service->path, NULL);
+  g_free (service->path);
+
+  g_slice_free (UnixService, service);
+}
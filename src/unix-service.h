@@ -0,0 +1,54 @@
+/*
+ * Sprite player
+ *
+ * An example effect using CoglGST
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef _UNIX_SERVICE_H
+#define _UNIX_SERVICE_H
+
+#include <gio/gio.h>
+
+/* A GSocketService listening on a UNIX domain socket. A socket left
+ * at the path by a previous instance is replaced but any other kind
+ * of file makes creating the service fail. The socket is removed
+ * again when the service is freed. The connections are handled from
+ * the thread-default main context of the thread that created the
+ * service */
+
+typedef struct _UnixService UnixService;
+
+/* The same as the GSocketService::incoming signal */
+typedef gboolean
+(* UnixServiceIncomingFunc) (GSocketService *service,
+                             GSocketConnection *connection,
+                             GObject *source_object,
+                             void *user_data);
+
+UnixService *
+unix_service_new (const char *path,
+                  UnixServiceIncomingFunc incoming_func,
+                  void *user_data,
+                  GError **error);
+
+void
+unix_service_free (UnixService *service);
+
+#endif /* _UNIX_SERVICE_H */
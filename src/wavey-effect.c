@@ -29,6 +29,7 @@
 #include <cogl-gst/cogl-gst.h>
 
 #include "effect.h"
+#include "texture-uploader.h"
 #include "borders.h"
 
 #define TEXTURE_SIZE 4096
@@ -62,10 +63,8 @@ paint (CoglFramebuffer *fb,
   Data *data = user_data;
   CoglPipeline *pipeline;
 
-  pipeline = cogl_pipeline_copy (data->pipeline);
-  cogl_gst_video_sink_attach_frame (data->sink, pipeline);
-  cogl_object_unref (data->pipeline);
-  data->pipeline = pipeline;
+  pipeline = data->pipeline;
+  texture_uploader_retarget_frame (data->sink, pipeline);
 
   borders_draw (data->borders, fb, video_output);
 
@@ -127,8 +126,6 @@ init (CoglContext *context,
 
   create_pipeline (data);
 
-  cogl_gst_video_sink_set_default_sample (data->sink, FALSE);
-
   return data;
 }
 
@@ -150,4 +147,4 @@ fini (void *user_data)
   free (data);
 }
 
-EFFECT_DEFINE ("Wavey", wavey_effect)
+EFFECT_DEFINE ("Wavey", wavey_effect, EFFECT_FLAG_CUSTOM_SAMPLE)